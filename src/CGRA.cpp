@@ -20,6 +20,10 @@ CGRA::CGRA(Options *opts, Parameters *params) {
   m_LinkCount = 2 * (m_rows * (m_columns-1) + (m_rows-1) * m_columns);
   links = new CGRALink*[m_LinkCount];
   m_params = params;
+  m_opts = opts;
+  m_regConstraint = -1;
+  m_ctrlMemConstraint = -1;
+  m_bypassConstraint = -1;
 
   // Initialize the CGRA nodes.
   int node_id = 0;
@@ -93,40 +97,7 @@ CGRA::CGRA(Options *opts, Parameters *params) {
     nodes[r][m_columns-1]->enableReturn();
   }
 
-  // Connect the CGRA nodes with links.
-  int link_id = 0;
-  for (int i=0; i<m_rows; ++i) {
-    for (int j=0; j<m_columns; ++j) {
-      if (i < m_rows - 1) {
-        links[link_id] = new CGRALink(link_id);
-        nodes[i][j]->attachOutLink(links[link_id]);
-        nodes[i+1][j]->attachInLink(links[link_id]);
-        links[link_id]->connect(nodes[i][j], nodes[i+1][j]);
-        ++link_id;
-      }
-      if (i > 0) {
-        links[link_id] = new CGRALink(link_id);
-        nodes[i][j]->attachOutLink(links[link_id]);
-        nodes[i-1][j]->attachInLink(links[link_id]);
-        links[link_id]->connect(nodes[i][j], nodes[i-1][j]);
-        ++link_id;
-      }
-      if (j < m_columns - 1) {
-        links[link_id] = new CGRALink(link_id);
-        nodes[i][j]->attachOutLink(links[link_id]);
-        nodes[i][j+1]->attachInLink(links[link_id]);
-        links[link_id]->connect(nodes[i][j], nodes[i][j+1]);
-        ++link_id;
-      }
-      if (j > 0) {
-        links[link_id] = new CGRALink(link_id);
-        nodes[i][j]->attachOutLink(links[link_id]);
-        nodes[i][j-1]->attachInLink(links[link_id]);
-        links[link_id]->connect(nodes[i][j], nodes[i][j-1]);
-        ++link_id;
-      }
-    }
-  }
+  connectNodes();
 
 /*
   cout<<"[connection] horizontal and vertical."<<endl;
@@ -164,6 +135,92 @@ CGRA::CGRA(Options *opts, Parameters *params) {
   disable();
 }
 
+// Connect the CGRA nodes with links.
+void CGRA::connectNodes() {
+  int link_id = 0;
+  for (int i=0; i<m_rows; ++i) {
+    for (int j=0; j<m_columns; ++j) {
+      if (i < m_rows - 1) {
+        links[link_id] = new CGRALink(link_id);
+        links[link_id]->connect(nodes[i][j], nodes[i+1][j]);
+        nodes[i][j]->attachOutLink(links[link_id]);
+        nodes[i+1][j]->attachInLink(links[link_id]);
+        ++link_id;
+      }
+      if (i > 0) {
+        links[link_id] = new CGRALink(link_id);
+        links[link_id]->connect(nodes[i][j], nodes[i-1][j]);
+        nodes[i][j]->attachOutLink(links[link_id]);
+        nodes[i-1][j]->attachInLink(links[link_id]);
+        ++link_id;
+      }
+      if (j < m_columns - 1) {
+        links[link_id] = new CGRALink(link_id);
+        links[link_id]->connect(nodes[i][j], nodes[i][j+1]);
+        nodes[i][j]->attachOutLink(links[link_id]);
+        nodes[i][j+1]->attachInLink(links[link_id]);
+        ++link_id;
+      }
+      if (j > 0) {
+        links[link_id] = new CGRALink(link_id);
+        links[link_id]->connect(nodes[i][j], nodes[i][j-1]);
+        nodes[i][j]->attachOutLink(links[link_id]);
+        nodes[i][j-1]->attachInLink(links[link_id]);
+        ++link_id;
+      }
+    }
+  }
+}
+
+// Builds a CGRA with the same tiles, links and constraints as 't_cgra',
+// without loading the parameters again. The MRRG is not copied.
+CGRA::CGRA(CGRA* t_cgra, Options *opts, Parameters *params) {
+  m_rows = t_cgra->m_rows;
+  m_columns = t_cgra->m_columns;
+  m_FUCount = t_cgra->m_FUCount;
+  m_LinkCount = t_cgra->m_LinkCount;
+  m_params = params;
+  m_opts = opts;
+  m_regConstraint = -1;
+  m_ctrlMemConstraint = -1;
+  m_bypassConstraint = -1;
+  nodes = new CGRANode**[m_rows];
+  links = new CGRALink*[m_LinkCount];
+  for (int i=0; i<m_rows; ++i) {
+    nodes[i] = new CGRANode*[m_columns];
+    for (int j=0; j<m_columns; ++j) {
+      nodes[i][j] = new CGRANode(t_cgra->nodes[i][j]->getID(), j, i,
+          (*((*(params->opmap))[i]))[j], opts, params);
+      nodes[i][j]->copyFunctionality(t_cgra->nodes[i][j]);
+    }
+  }
+  connectNodes();
+  for (int i=0; i<m_rows; ++i) {
+    for (int j=0; j<m_columns; ++j) {
+      if (t_cgra->nodes[i][j]->isDisabled())
+        nodes[i][j]->disable();
+    }
+  }
+  if (t_cgra->m_regConstraint != -1)
+    setRegConstraint(t_cgra->m_regConstraint);
+  if (t_cgra->m_ctrlMemConstraint != -1)
+    setCtrlMemConstraint(t_cgra->m_ctrlMemConstraint);
+  if (t_cgra->m_bypassConstraint != -1)
+    setBypassConstraint(t_cgra->m_bypassConstraint);
+}
+
+CGRA::~CGRA() {
+  for (int i=0; i<m_rows; ++i) {
+    for (int j=0; j<m_columns; ++j)
+      delete nodes[i][j];
+    delete[] nodes[i];
+  }
+  delete[] nodes;
+  for (int i=0; i<m_LinkCount; ++i)
+    delete links[i];
+  delete[] links;
+}
+
 void CGRA::disable() {
 //  nodes[0][0]->disable();
 //  nodes[0][1]->disable();
@@ -192,18 +249,45 @@ void CGRA::disable() {
 
 }
 
+// Builds an independent CGRA with the same configuration, so that another
+// mapping can be carried out on its own MRRG.
+CGRA* CGRA::clone() {
+  return clone(m_opts, m_params);
+}
+
+CGRA* CGRA::clone(Options *opts, Parameters *params) {
+  return new CGRA(this, opts, params);
+}
+
+// Attaches the undo log to all the tiles and links (NULL detaches it).
+void CGRA::setTrail(MappingTrail* t_trail) {
+  for (int i=0; i<m_rows; ++i)
+    for (int j=0; j<m_columns; ++j)
+      nodes[i][j]->setTrail(t_trail);
+  for (int i=0; i<m_LinkCount; ++i)
+    links[i]->setTrail(t_trail);
+}
+
+void CGRA::clearHistoryCosts() {
+  for (int i=0; i<m_LinkCount; ++i)
+    links[i]->clearHistoryCost();
+}
+
 void CGRA::setRegConstraint(int t_regConstraint) {
+  m_regConstraint = t_regConstraint;
   for (int i=0; i<m_rows; ++i)
     for (int j=0; j<m_columns; ++j)
       nodes[i][j]->setRegConstraint(t_regConstraint);
 }
 
 void CGRA::setBypassConstraint(int t_bypassConstraint) {
+  m_bypassConstraint = t_bypassConstraint;
   for (int i=0; i<m_LinkCount; ++i)
     links[i]->setBypassConstraint(t_bypassConstraint);
 }
 
 void CGRA::setCtrlMemConstraint(int t_ctrlMemConstraint) {
+  m_ctrlMemConstraint = t_ctrlMemConstraint;
   for (int i=0; i<m_rows; ++i)
     for (int j=0; j<m_columns; ++j)
       nodes[i][j]->setCtrlMemConstraint(t_ctrlMemConstraint);
@@ -216,6 +300,10 @@ int CGRA::getFUCount() {
   return m_FUCount;
 }
 
+int CGRA::getLinkCount() {
+  return m_LinkCount;
+}
+
 void CGRA::constructMRRG(int t_II) {
   for (int i=0; i<m_rows; ++i)
     for (int j=0; j<m_columns; ++j)
@@ -225,11 +313,9 @@ void CGRA::constructMRRG(int t_II) {
 }
 
 CGRALink* CGRA::getLink(CGRANode* t_n1, CGRANode* t_n2) {
-   for (int i=0; i<m_LinkCount; ++i) {
-     if (links[i]->getSrc()==t_n1 and links[i]->getDst() == t_n2) {
-       return links[i];
-     }
-  }
+  CGRALink* link = t_n1->getOutLink(t_n2);
+  if (link != NULL)
+    return link;
   cout << "bad quiry for CGRA link\n";
   return NULL;
 //  assert(0);
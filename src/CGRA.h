@@ -27,17 +27,30 @@ class CGRA {
     int m_rows;
     int m_columns;
     Parameters * m_params;
+    Options * m_opts;
+    int m_regConstraint;
+    int m_ctrlMemConstraint;
+    int m_bypassConstraint;
     void disable();
+    void connectNodes();
+    CGRA(CGRA*, Options*, Parameters*);
 
   public:
     CGRA(Options *, Parameters *);
+    ~CGRA();
+    CGRA* clone();
+    CGRA* clone(Options*, Parameters*);
     CGRANode ***nodes;
     CGRALink **links;
     int getFUCount();
+    int getLinkCount();
     void getRoutingResource();
     void constructMRRG(int);
+    void setTrail(MappingTrail*);
+    void clearHistoryCosts();
     int getRows() { return m_rows; }
     int getColumns() { return m_columns; }
+    CGRANode* getNode(int t_id) { return nodes[t_id/m_columns][t_id%m_columns]; }
     CGRALink* getLink(CGRANode*, CGRANode*);
     void setBypassConstraint(int);
     void setCtrlMemConstraint(int);
@@ -14,12 +14,13 @@
 CGRALink::CGRALink(int t_linkId) {
   setID(t_linkId);
   m_currentCtrlMemItems = 0;
-  m_occupied = new bool[1];
   m_dfgNodes = new DFGNode*[1];
-  m_bypassed = new bool[1];
-  m_generatedOut = new bool[1];
-  m_arrived = new bool[1];
   m_disabled = false;
+  m_trail = NULL;
+}
+
+CGRALink::~CGRALink() {
+  delete[] m_dfgNodes;
 }
 
 void CGRALink::setCtrlMemConstraint(int t_ctrlMemConstraint) {
@@ -30,9 +31,15 @@ void CGRALink::setBypassConstraint(int t_bypassConstraint) {
   m_bypassConstraint = t_bypassConstraint;
 }
 
+int CGRALink::getCurrentCtrlMemItems() {
+  return m_currentCtrlMemItems;
+}
+
 void CGRALink::connect(CGRANode* t_src, CGRANode* t_dst) {
   m_src = t_src;
   m_dst = t_dst;
+  m_srcDirectionID = findDirectionID(m_src);
+  m_dstDirectionID = findDirectionID(m_dst);
 }
 
 CGRANode* CGRALink::getConnectedNode(CGRANode* t_node) {
@@ -55,26 +62,44 @@ void CGRALink::setID(int t_id) {
 void CGRALink::constructMRRG(int t_CGRANodeCount, int t_II) {
   m_II = t_II;
   m_cycleBoundary = t_CGRANodeCount*t_II*t_II;
-  delete[] m_occupied;
-  m_occupied = new bool[m_cycleBoundary];
+  m_occupied.reset(m_II);
+  m_bypassed.reset(m_II);
+  m_generatedOut.reset(m_II);
+  m_arrived.reset(m_II);
   delete[] m_dfgNodes;
-  m_dfgNodes = new DFGNode*[m_cycleBoundary];
-  delete[] m_bypassed;
-  m_bypassed = new bool[m_cycleBoundary];
-  delete[] m_generatedOut;
-  m_generatedOut = new bool[m_cycleBoundary];
-  delete[] m_arrived;
-  m_arrived = new bool[m_cycleBoundary];
+  m_dfgNodes = new DFGNode*[m_II];
   m_currentCtrlMemItems = 0;
-  for(int i=0; i<m_cycleBoundary; ++i) {
-    m_occupied[i] = false;
+  for(int i=0; i<m_II; ++i) {
     m_dfgNodes[i] = NULL;
-    m_bypassed[i] = false;
-    m_generatedOut[i] = false;
-    m_arrived[i] = false;
   }
 }
 
+void CGRALink::setTrail(MappingTrail* t_trail) {
+  m_trail = t_trail;
+}
+
+int CGRALink::getHistoryCost(int t_cycle) {
+  if ((int)m_historyCost.size() != m_II)
+    return 0;
+  return m_historyCost[getSlot(t_cycle)];
+}
+
+void CGRALink::addHistoryCost(int t_cycle) {
+  if ((int)m_historyCost.size() != m_II)
+    m_historyCost.assign(m_II, 0);
+  ++m_historyCost[getSlot(t_cycle)];
+}
+
+void CGRALink::clearHistoryCost() {
+  m_historyCost.clear();
+}
+
+// Maps the cycle (can be negative when looking back from the first
+// iteration) onto the modulo slot.
+int CGRALink::getSlot(int t_cycle) {
+  return (t_cycle%m_II+m_II)%m_II;
+}
+
 bool CGRALink::satisfyBypassConstraint(int t_cycle, int t_II) {
   CGRANode* outCGRANode = getDst();
   // If no DFG node is mapped onto the outCGRANode.
@@ -114,7 +139,7 @@ bool CGRALink::canOccupy(int t_cycle, int t_II) {
     return false;
   if (m_currentCtrlMemItems + 1 > m_ctrlMemSize)
     return false;
-  if (m_occupied[t_cycle])
+  if (m_occupied.test(getSlot(t_cycle)))
     return false;
   if (!satisfyBypassConstraint(t_cycle, t_II))
     return false;
@@ -127,11 +152,12 @@ bool CGRALink::canOccupy(DFGNode* t_srcDFGNode, CGRANode* t_srcCGRANode,
   // cout<<"[link->canOccupy() 1] ("<<m_src->getID()<<")->("<<m_dst->getID()<<")..."<<endl;
   if (m_disabled)
     return false;
-  if (m_dfgNodes[t_cycle] != NULL and t_srcDFGNode == m_dfgNodes[t_cycle])
+  int slot = getSlot(t_cycle);
+  if (m_dfgNodes[slot] != NULL and t_srcDFGNode == m_dfgNodes[slot])
     return true;
   if (m_currentCtrlMemItems + 1 > m_ctrlMemSize)
     return false;
-  if (m_occupied[t_cycle])
+  if (m_occupied.test(slot))
     return false;
   if (!satisfyBypassConstraint(t_cycle, t_II))
     return false;
@@ -142,14 +168,14 @@ bool CGRALink::canOccupy(DFGNode* t_srcDFGNode, CGRANode* t_srcCGRANode,
   if (getSrc() == t_srcCGRANode) {
     int t = (t_cycle+1) % t_II;
     if (m_dfgNodes[t] != NULL and
-        !m_generatedOut[t]) {
+        !m_generatedOut.test(t)) {
       return false;
     }
   } else { // On the other hand, the link for bypass is blocked
            // by the resultOut for 2 cycles:
     int t = (t_cycle+t_II-1) % t_II;
     if (m_dfgNodes[t] != NULL and
-        m_generatedOut[t]) {
+        m_generatedOut.test(t)) {
       return false;
     }
 
@@ -175,23 +201,20 @@ bool CGRALink::canOccupy(DFGNode* t_srcDFGNode, int t_cycle, int t_II) {
 */
 
 bool CGRALink::isOccupied(int t_cycle) {
-  return m_occupied[t_cycle];
+  return m_occupied.test(getSlot(t_cycle));
 }
 
-bool CGRALink::isOccupied(int t_cycle, int t_II, bool t_isStaticElasticCGRA) {
-  int interval = t_II;
-  if (t_isStaticElasticCGRA)
-    interval = 1;
-  for (int i=t_cycle; i<m_cycleBoundary; i=i+interval) {
-    if (m_occupied[i]) {
-      return true;
-    }
-  }
-  return false;
+// The static elastic CGRA keeps the link occupied all the time.
+bool CGRALink::isOccupied(int t_cycle, bool t_isStaticElasticCGRA) {
+  if (t_cycle >= m_cycleBoundary)
+    return false;
+  if (!t_isStaticElasticCGRA)
+    return m_occupied.test(getSlot(t_cycle));
+  return m_occupied.any();
 }
 
 bool CGRALink::isReused(int t_cycle) {
-  return m_occupied[t_cycle];
+  return m_occupied.test(getSlot(t_cycle));
 }
 
 void CGRALink::occupy(DFGNode* t_srcDFGNode, int t_cycle, int duration,
@@ -201,58 +224,44 @@ void CGRALink::occupy(DFGNode* t_srcDFGNode, int t_cycle, int duration,
     interval = 1;
     t_cycle = 0;
   }
-  for(int cycle=t_cycle; cycle<m_cycleBoundary; cycle+=interval) {
-    m_dfgNodes[cycle] = t_srcDFGNode;
-    m_occupied[cycle] = true;
-    // Only set 'm_bypassed' as true if it is bypassed.
-    // Will never set it back to false.
-    if (t_isBypass)
-      m_bypassed[cycle] = true;
-    if (t_isGeneratedOut)
-      m_generatedOut[cycle] = true;
-    // Only set 'm_arrived' as true if it is not bypassed.
-    // Will never set it back to false.
-    if (!t_isBypass)
-      m_arrived[cycle] = true;
-  }
-  for(int cycle=t_cycle; cycle>=0; cycle-=interval) {
-    m_dfgNodes[cycle] = t_srcDFGNode;
-    m_occupied[cycle] = true;
+  // The slot already delivers the data to another consumer (multicast), it
+  // is configured once.
+  bool isShared = m_dfgNodes[t_cycle%interval] == t_srcDFGNode;
+  for(int slot=t_cycle%interval; slot<m_II; slot+=interval) {
+    if (m_trail != NULL)
+      m_trail->savePointer(&m_dfgNodes[slot]);
+    m_dfgNodes[slot] = t_srcDFGNode;
+    m_occupied.set(slot, m_trail);
     // Only set 'm_bypassed' as true if it is bypassed.
     // Will never set it back to false.
     if (t_isBypass)
-      m_bypassed[cycle] = true;
+      m_bypassed.set(slot, m_trail);
     if (t_isGeneratedOut)
-      m_generatedOut[cycle] = true;
+      m_generatedOut.set(slot, m_trail);
     // Only set 'm_arrived' as true if it is not bypassed.
     // Will never set it back to false.
     if (!t_isBypass)
-      m_arrived[cycle] = true;
+      m_arrived.set(slot, m_trail);
   }
   if (!t_isBypass) {
     m_dst->allocateReg(this, t_cycle, duration, interval);
   }
 
-  ++m_currentCtrlMemItems;
+  if (!isShared) {
+    if (m_trail != NULL)
+      m_trail->saveInt(&m_currentCtrlMemItems);
+    ++m_currentCtrlMemItems;
+  }
 
   // cout<<"[CHENG] occupy link["<<m_src->getID()<<"]-->["<<m_dst->getID()<<"] (bypass:"<<t_isBypass<<") dfgNode: "<<t_srcDFGNode->getID()<<" at cycle "<<t_cycle<<"\n";
 }
 
 DFGNode* CGRALink::getMappedDFGNode(int t_cycle) {
-  if (t_cycle < 0) {
-//    if (m_dfgNodes[m_II+t_cycle] == NULL) {
-//      errs()<<"[cheng] 1 no mapped DFG node at cycle "<<t_cycle<<"\n";
-//    }
-    return m_dfgNodes[m_II+t_cycle];
-  }
-//  if (m_dfgNodes[t_cycle] == NULL) {
-//    errs()<<"[cheng] 2 no mapped DFG node at cycle "<<t_cycle<<"\n";
-//  }
-  return m_dfgNodes[t_cycle];
+  return m_dfgNodes[getSlot(t_cycle)];
 }
 
 bool CGRALink::isBypass(int t_cycle) {
-  return m_bypassed[t_cycle];
+  return m_bypassed.test(getSlot(t_cycle));
 }
 
 CGRANode* CGRALink::getSrc() {
@@ -263,6 +272,13 @@ CGRANode* CGRALink::getDst() {
 }
 
 int CGRALink::getDirectionID(CGRANode* t_cgraNode) {
+  if (m_src == t_cgraNode)
+    return m_srcDirectionID;
+  assert(m_dst == t_cgraNode);
+  return m_dstDirectionID;
+}
+
+int CGRALink::findDirectionID(CGRANode* t_cgraNode) {
   if (m_src == t_cgraNode) {
     if (m_src->getX() > m_dst->getX())
       // return "W";
@@ -295,25 +311,11 @@ int CGRALink::getDirectionID(CGRANode* t_cgraNode) {
 }
 
 string CGRALink::getDirection(CGRANode* t_cgraNode) {
-  if (m_src == t_cgraNode) {
-    if (m_src->getX() > m_dst->getX())
-      return "W";
-    else if (m_src->getX() < m_dst->getX())
-      return "E";
-    else if (m_src->getY() > m_dst->getY())
-      return "S";
-    else if (m_src->getY() < m_dst->getY())
-      return "N";
-  } else {
-    assert(m_dst == t_cgraNode);
-    if (m_src->getX() > m_dst->getX())
-      return "E";
-    else if (m_src->getX() < m_dst->getX())
-      return "W";
-    else if (m_src->getY() > m_dst->getY())
-      return "N";
-    else if (m_src->getY() < m_dst->getY())
-      return "S";
+  switch (getDirectionID(t_cgraNode)) {
+    case 0: return "N";
+    case 1: return "S";
+    case 2: return "W";
+    case 3: return "E";
   }
   return "self";
 }
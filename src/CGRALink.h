@@ -16,6 +16,8 @@
 
 #include "CGRANode.h"
 #include "DFGNode.h"
+#include "SlotBitset.h"
+#include "MappingTrail.h"
 
 //using namespace llvm;
 using namespace std;
@@ -33,17 +35,30 @@ class CGRALink
     int m_bypassConstraint;
     int m_currentCtrlMemItems;
 
+    // The link is modulo reserved, the MRRG only keeps II slots and
+    // 'm_cycleBoundary' bounds the schedule horizon.
     int m_cycleBoundary;
     bool m_disabled;
-    bool* m_occupied;
-    bool* m_bypassed;
-    bool* m_generatedOut;
-    bool* m_arrived;
+    SlotBitset m_occupied;
+    SlotBitset m_bypassed;
+    SlotBitset m_generatedOut;
+    SlotBitset m_arrived;
     DFGNode** m_dfgNodes;
+    MappingTrail* m_trail;
+    // The direction of the link seen from its source and its destination,
+    // fixed once the link is connected.
+    int m_srcDirectionID;
+    int m_dstDirectionID;
+    // The history cost of each slot for the history rerouting, it is kept
+    // across the MRRGs of the same II (see CGRA::clearHistoryCosts()).
+    vector<int> m_historyCost;
+    int findDirectionID(CGRANode*);
     bool satisfyBypassConstraint(int, int);
+    int getSlot(int);
 
   public:
     CGRALink(int);
+    ~CGRALink();
     void setID(int);
     int getID();
     CGRANode*  getSrc();
@@ -52,9 +67,10 @@ class CGRALink
     CGRANode* getConnectedNode(CGRANode*);
 
     void constructMRRG(int, int);
+    void setTrail(MappingTrail*);
     bool canOccupy(int, int);
     bool isOccupied(int);
-    bool isOccupied(int, int, bool);
+    bool isOccupied(int, bool);
     bool canOccupy(DFGNode*, CGRANode*, int, int);
     void occupy(DFGNode*, int, int, int, bool, bool, bool);
     bool isBypass(int);
@@ -64,7 +80,11 @@ class CGRALink
     DFGNode* getMappedDFGNode(int);
     void setCtrlMemConstraint(int);
     void setBypassConstraint(int);
+    int getCurrentCtrlMemItems();
     int getBypassConstraint();
+    int getHistoryCost(int);
+    void addHistoryCost(int);
+    void clearHistoryCost();
     void disable();
 };
 
@@ -12,6 +12,7 @@
 #include "OperationMap.h"
 #include "Options.h"
 #include <stdio.h>
+#include <assert.h>
 
 #define SINGLE_OCCUPY     0 // A single-cycle opt is in the FU
 #define START_PIPE_OCCUPY 1 // A multi-cycle opt starts in the FU
@@ -36,19 +37,45 @@ CGRANode::CGRANode(int t_id, int t_x, int t_y, list<OperationNumber>* ops, Optio
   m_supportComplex = false;
   m_x = t_x;
   m_y = t_y;
-  m_neighbors = NULL;
+  for (int i=0; i<CGRA_DIRECTIONS; ++i) {
+    m_inLinkAt[i] = NULL;
+    m_outLinkAt[i] = NULL;
+    m_neighborAt[i] = NULL;
+  }
   m_occupiableInLinks = NULL;
   m_occupiableOutLinks = NULL;
   // new list<list<pair<DFGNode*, int>>*>();//DFGNode*[1];
   // m_dfgNodes = new DFGNode*[1];
   // m_fuOccupied = new int[1];
-  m_regs_duration = NULL;
   m_regs_timing = NULL;
+  m_trail = NULL;
   operations = ops;
+  m_operationSet.add(ops);
   m_build_cgra = opts->BuildCGRA;
   m_params = params;
 }
 
+CGRANode::~CGRANode() {
+  if (m_regs_timing != NULL) {
+    for (int i=0; i<m_II; ++i) {
+      delete[] m_regs_timing[i];
+    }
+    delete[] m_regs_timing;
+  }
+  delete m_occupiableInLinks;
+  delete m_occupiableOutLinks;
+}
+
+// Enables the same functionalities as 't_node' has (the MRRG and the links
+// are not copied).
+void CGRANode::copyFunctionality(CGRANode* t_node) {
+  m_canReturn = t_node->m_canReturn;
+  m_canStore = t_node->m_canStore;
+  m_canLoad = t_node->m_canLoad;
+  m_canCall = t_node->m_canCall;
+  m_supportComplex = t_node->m_supportComplex;
+}
+
 // FIXME: should handle the case that the data is maintained in the registers
 //        for multiple cycles.
 void CGRANode::allocateReg(CGRALink* t_link, int t_cycle, int t_duration, int t_II) {
@@ -56,43 +83,27 @@ void CGRANode::allocateReg(CGRALink* t_link, int t_cycle, int t_duration, int t_
   allocateReg(reg_id, t_cycle, t_duration, t_II);
 }
 
+// The register file is modulo scheduled as well, i.e., a register allocated
+// at 't_cycle' for 't_duration' cycles is busy in the same slots of every
+// iteration. 't_II' is the interval of the allocation, which is 1 for the
+// static elastic CGRA.
 void CGRANode::allocateReg(int t_port_id, int t_cycle, int t_duration, int t_II) {
   bool allocated = false;
+  SlotBitset requested;
+  requested.reset(m_II);
+  for (int slot=t_cycle%t_II; slot<m_II; slot+=t_II) {
+    requested.setRange(slot, t_duration);
+  }
 //  errs()<<"[cheng] inside allocateReg() t_cycle: "<<t_cycle<<" CGRA node: "<<this->getID()<<"; link: "<<t_link->getDirection(this)<<" duration: "<<t_duration<<" registerCount: "<<m_registerCount<<"\n";
   for (int i=0; i<m_registerCount; ++i) {
-    bool reg_occupied = false;
-    for (int cycle=t_cycle; cycle<m_cycleBoundary; cycle+=t_II) {
-      for (int d=0; d<t_duration; ++d) {
-        if (cycle+d<m_cycleBoundary and m_regs_duration[cycle+d][i] != -1)
-          reg_occupied = true;
-      }
-    }
-    for (int cycle=t_cycle; cycle>=0; cycle-=t_II) {
-      for (int d=0; d<t_duration; ++d) {
-        if (m_regs_duration[cycle+d][i] != -1)
-          reg_occupied = true;
-      }
-    }
-    if (reg_occupied == false) {
+    if (!m_regsOccupied[i].intersects(requested)) {
       // cout<<"[cheng] in allocateReg() t_cycle: "<<t_cycle<<"; i: "<<i<<" CGRA node: "<<this->getID()<<"; link: "<<t_port_id<<" duration "<<t_duration<<"\n";
-      for (int cycle=t_cycle; cycle<m_cycleBoundary; cycle+=t_II) {
-        m_regs_timing[cycle][i] = t_port_id;
-//        if (cycle < 20)
-//          errs()<<"[cheng] see m_regs_timing["<<cycle<<"]["<<i<<"]: "<<m_regs_timing[cycle][i]<<"\n";
-        for (int d=0; d<t_duration; ++d) {
-          if (cycle+d<m_cycleBoundary) {
-            // assert(m_regs_duration[cycle+d][i] == -1);
-            m_regs_duration[cycle+d][i] = t_port_id;
-          }
-        }
+      for (int slot=t_cycle%t_II; slot<m_II; slot+=t_II) {
+        if (m_trail != NULL)
+          m_trail->saveInt(&m_regs_timing[slot][i]);
+        m_regs_timing[slot][i] = t_port_id;
       }
-      for (int cycle=t_cycle; cycle>=0; cycle-=t_II) {
-        m_regs_timing[cycle][i] = t_port_id;
-        for (int d=0; d<t_duration; ++d) {
-          m_regs_duration[cycle+d][i] = t_port_id;
-        }
-      }
-//      errs()<<"[cheng] in detail about register alloc -- m_regs[2][0]: "<<m_regs[2][0]<<"; duration: "<<t_duration<<"\n";
+      m_regsOccupied[i].unite(requested, m_trail);
       allocated = true;
       break;
     }
@@ -102,7 +113,7 @@ void CGRANode::allocateReg(int t_port_id, int t_cycle, int t_duration, int t_II)
 }
 
 int* CGRANode::getRegsAllocation(int t_cycle) {
-  return m_regs_timing[t_cycle];
+  return m_regs_timing[t_cycle%m_II];
 }
 
 void CGRANode::setCtrlMemConstraint(int t_ctrlMemConstraint) {
@@ -126,12 +137,19 @@ int CGRANode::getID() {
   return m_id;
 }
 
+// The link needs to be connected before it is attached, so that its
+// direction is known.
 void CGRANode::attachInLink(CGRALink* t_link) {
   m_inLinks.push_back(t_link);
+  m_inLinkAt[t_link->getDirectionID(this)] = t_link;
 }
 
 void CGRANode::attachOutLink(CGRALink* t_link) {
+  int direction = t_link->getDirectionID(this);
   m_outLinks.push_back(t_link);
+  m_outLinkAt[direction] = t_link;
+  m_neighborAt[direction] = t_link->getDst();
+  m_neighbors.push_back(t_link->getDst());
 }
 
 list<CGRALink*>* CGRANode::getInLinks() {
@@ -143,42 +161,64 @@ list<CGRALink*>* CGRANode::getOutLinks() {
 }
 
 list<CGRANode*>* CGRANode::getNeighbors() {
-  if (m_neighbors != NULL)
-    return m_neighbors;
-  m_neighbors = new list<CGRANode*>();
-  for (CGRALink* link: m_outLinks)
-    m_neighbors->push_back(link->getConnectedNode(this));
-  return m_neighbors;
+  return &m_neighbors;
+}
+
+CGRANode* CGRANode::getNeighbor(int t_direction) {
+  return m_neighborAt[t_direction];
+}
+
+// Returns the direction ID of the adjacent 't_node' as seen from this tile,
+// or -1 if the two tiles are not adjacent.
+int CGRANode::getDirectionTo(CGRANode* t_node) {
+  int dx = t_node->m_x - m_x;
+  int dy = t_node->m_y - m_y;
+  if (dx == 0 and dy == 1)
+    return 0;
+  if (dx == 0 and dy == -1)
+    return 1;
+  if (dx == -1 and dy == 0)
+    return 2;
+  if (dx == 1 and dy == 0)
+    return 3;
+  return -1;
 }
 
 void CGRANode::constructMRRG(int t_CGRANodeCount, int t_II) {
+  // Delete the tables of the previous II to avoid memory leakage.
+  if (m_regs_timing != NULL) {
+    for (int i=0; i<m_II; ++i) {
+      delete[] m_regs_timing[i];
+    }
+    delete[] m_regs_timing;
+  }
+  m_II = t_II;
   m_cycleBoundary = t_CGRANodeCount*t_II*t_II;
   m_currentCtrlMemItems = 0;
   m_registers.clear();
-  // Delete all these local arrays to avoid memory leakage.
-  if (m_dfgNodesWithOccupyStatus.size() > 0) {
-    for (list<pair<DFGNode*, int>>* opts: m_dfgNodesWithOccupyStatus) {
-      opts->clear();
-    }
-  }
-  m_dfgNodesWithOccupyStatus.clear();
-  // m_dfgNodesWithOccupyStatus = new list<list<pair<DFGNode*, int>>*>();
-  for (int i=0; i<m_cycleBoundary; ++i) {
-    m_dfgNodesWithOccupyStatus.push_back(new list<pair<DFGNode*, int>>());
+  m_dfgNodesWithOccupyStatus.assign(m_II, list<FUOccupancy>());
+  m_fuStarted.reset(m_II);
+  m_fuEnded.reset(m_II);
+
+  m_regsOccupied.assign(m_registerCount, SlotBitset());
+  for (int j=0; j<m_registerCount; ++j) {
+    m_regsOccupied[j].reset(m_II);
   }
-  
-  m_regs_duration = new int*[m_cycleBoundary];
-  m_regs_timing = new int*[m_cycleBoundary];
-  for (int i=0; i<m_cycleBoundary; ++i) {
-    m_regs_duration[i] = new int[m_registerCount];
+  m_regs_timing = new int*[m_II];
+  for (int i=0; i<m_II; ++i) {
     m_regs_timing[i] = new int[m_registerCount];
     for (int j=0; j<m_registerCount; ++j) {
-      m_regs_duration[i][j] = -1;
       m_regs_timing[i][j] = -1;
     }
   }
 }
 
+// Records the following updates of the MRRG into 't_trail' (NULL stops the
+// recording).
+void CGRANode::setTrail(MappingTrail* t_trail) {
+  m_trail = t_trail;
+}
+
 bool CGRANode::canSupport(DFGNode* t_opt) {
   if (m_disabled) 
     return false;
@@ -213,7 +253,7 @@ bool CGRANode::canSupport(DFGNode* t_opt) {
   if (m_build_cgra) {
 	  return true;
   } else {
-	  bool supported = std::find(operations->begin(), operations->end(), t_opt->getOperation()) != operations->end();
+	  bool supported = m_operationSet.contains(t_opt->getOperationID());
 	  /* if (DebugOperationMap) { */
 		  /* cout << "Operation " << t_opt->getOperation() << "is supported: " << supported << endl; */
 	  /* } */
@@ -237,54 +277,37 @@ bool CGRANode::canOccupy(DFGNode* t_opt, int t_cycle, int t_II) {
   }
 
   // Handle multi-cycle execution and pipelinable operations.
+  int slot = t_cycle%t_II;
   if (not t_opt->isMultiCycleExec()) {
-    // Single-cycle opt:
-    for (int cycle=t_cycle%t_II; cycle<m_cycleBoundary; cycle+=t_II) {
-      for (pair<DFGNode*, int> p: *(m_dfgNodesWithOccupyStatus[cycle])) {
-        if (p.second != IN_PIPE_OCCUPY) {
-          return false;
-        }
-      }
+    // Single-cycle opt can only overlap with the middle of a multi-cycle opt.
+    if (m_fuStarted.test(slot) or m_fuEnded.test(slot)) {
+      return false;
     }
   } else {
     // Multi-cycle opt.
-    for (int cycle=t_cycle%t_II; cycle<m_cycleBoundary; cycle+=t_II) {
-      // Check start cycle.
-      for (pair<DFGNode*, int> p: *(m_dfgNodesWithOccupyStatus[cycle])) {
-        // Multi-cycle opt's start cycle overlaps with single-cycle opt' cycle.
-        if (p.second == SINGLE_OCCUPY) {
-          return false;
-        } 
-        // Multi-cycle opt's start cycle overlaps with multi-cycle opt's start cycle.
-        else if (p.second == START_PIPE_OCCUPY) {
-          return false;
-        }
-        // Multi-cycle opt's start cycle overlaps with multi-cycle opt with the same type:
-        else if ((p.second == IN_PIPE_OCCUPY or p.second == END_PIPE_OCCUPY) and
-                 (t_opt->shareFU(p.first))   and
-                 (not t_opt->isPipelinable() or not p.first->isPipelinable())) {
-          return false;
-        }
-      }
-      if (cycle+t_opt->getExecLatency()-1 >= m_cycleBoundary) {
-        break;
+    // Multi-cycle opt's start cycle overlaps with single-cycle opt' cycle or
+    // multi-cycle opt's start cycle, and its end cycle overlaps with
+    // single-cycle opt' cycle or multi-cycle opt's end cycle.
+    int endSlot = (slot+t_opt->getExecLatency()-1)%t_II;
+    if (m_fuStarted.test(slot) or m_fuEnded.test(endSlot)) {
+      return false;
+    }
+    // Check start cycle.
+    for (FUOccupancy p: m_dfgNodesWithOccupyStatus[slot]) {
+      // Multi-cycle opt's start cycle overlaps with multi-cycle opt with the same type:
+      if ((p.status == IN_PIPE_OCCUPY or p.status == END_PIPE_OCCUPY) and
+          (t_opt->shareFU(p.dfgNode))   and
+          (not t_opt->isPipelinable() or not p.dfgNode->isPipelinable())) {
+        return false;
       }
-      // Check end cycle.
-      for (pair<DFGNode*, int> p: *(m_dfgNodesWithOccupyStatus[cycle+t_opt->getExecLatency()-1])) {
-        // Multi-cycle opt's end cycle overlaps with single-cycle opt' cycle.
-        if (p.second == SINGLE_OCCUPY) {
-          return false;
-        } 
-        // Multi-cycle opt's end cycle overlaps with multi-cycle opt's end cycle.
-        else if (p.second == END_PIPE_OCCUPY) {
-          return false;
-        }
-        // Multi-cycle opt's end cycle overlaps with multi-cycle opt with the same type:
-        else if ((p.second == IN_PIPE_OCCUPY or p.second == START_PIPE_OCCUPY) and
-                 (t_opt->shareFU(p.first))   and
-                 (not t_opt->isPipelinable() or not p.first->isPipelinable())) {
-          return false;
-        }
+    }
+    // Check end cycle.
+    for (FUOccupancy p: m_dfgNodesWithOccupyStatus[endSlot]) {
+      // Multi-cycle opt's end cycle overlaps with multi-cycle opt with the same type:
+      if ((p.status == IN_PIPE_OCCUPY or p.status == START_PIPE_OCCUPY) and
+          (t_opt->shareFU(p.dfgNode))   and
+          (not t_opt->isPipelinable() or not p.dfgNode->isPipelinable())) {
+        return false;
       }
     }
   }
@@ -292,16 +315,21 @@ bool CGRANode::canOccupy(DFGNode* t_opt, int t_cycle, int t_II) {
   return true;
 }
 
+// The MRRG only keeps the slots of its own II.
 bool CGRANode::isOccupied(int t_cycle, int t_II) {
-  for (int cycle=t_cycle; cycle<m_cycleBoundary; cycle+=t_II) {
-    for (pair<DFGNode*, int> p: *(m_dfgNodesWithOccupyStatus[cycle])) {
-      // if (m_fuOccupied[cycle])
-      if (p.second == START_PIPE_OCCUPY or p.second == SINGLE_OCCUPY) {
-        return true;
-      }
-    }
-  }
-  return false;
+  assert(t_II == m_II);
+  if (t_cycle >= m_cycleBoundary)
+    return false;
+  return m_fuStarted.test(t_cycle%m_II);
+}
+
+// The opt occupies the slot of 't_cycle' (and the following slots for the
+// multi-cycle opt) in every iteration. The static elastic CGRA repeats the
+// opt every cycle.
+void CGRANode::occupyFU(int t_slot, FUOccupancy t_occupancy) {
+  m_dfgNodesWithOccupyStatus[t_slot].push_back(t_occupancy);
+  if (m_trail != NULL)
+    m_trail->savePushBack(&m_dfgNodesWithOccupyStatus[t_slot]);
 }
 
 void CGRANode::setDFGNode(DFGNode* t_opt, int t_cycle, int t_II,
@@ -310,41 +338,46 @@ void CGRANode::setDFGNode(DFGNode* t_opt, int t_cycle, int t_II,
   if (t_isStaticElasticCGRA) {
     interval = 1;
   }
-  for (int cycle=t_cycle%interval; cycle<m_cycleBoundary; cycle+=interval) {
+  for (int slot=t_cycle%interval; slot<m_II; slot+=interval) {
     if (not t_opt->isMultiCycleExec()) {
-      m_dfgNodesWithOccupyStatus[cycle]->push_back(make_pair(t_opt, SINGLE_OCCUPY));
+      occupyFU(slot, {t_opt, SINGLE_OCCUPY, slot});
+      m_fuStarted.set(slot, m_trail);
+      m_fuEnded.set(slot, m_trail);
     } else {
-      m_dfgNodesWithOccupyStatus[cycle]->push_back(make_pair(t_opt, START_PIPE_OCCUPY));
+      occupyFU(slot, {t_opt, START_PIPE_OCCUPY, slot});
+      m_fuStarted.set(slot, m_trail);
       for (int i=1; i<t_opt->getExecLatency()-1; ++i) {
-        if (cycle+i < m_cycleBoundary) {
-          m_dfgNodesWithOccupyStatus[cycle+i]->push_back(make_pair(t_opt, IN_PIPE_OCCUPY));
-        }
-      }
-      int lastCycle = cycle+t_opt->getExecLatency()-1;
-      if (lastCycle < m_cycleBoundary) {
-        m_dfgNodesWithOccupyStatus[lastCycle]->push_back(make_pair(t_opt, END_PIPE_OCCUPY));
+        occupyFU((slot+i)%m_II, {t_opt, IN_PIPE_OCCUPY, slot+i});
       }
+      int lastCycle = slot+t_opt->getExecLatency()-1;
+      occupyFU(lastCycle%m_II, {t_opt, END_PIPE_OCCUPY, lastCycle});
+      m_fuEnded.set(lastCycle%m_II, m_trail);
     }
   }
 
   // cout<<"[CHENG] setDFGNode "<<t_opt->getID()<<" onto CGRANode "<<getID()<<" at cycle: "<<t_cycle<<"\n";
+  if (m_trail != NULL)
+    m_trail->saveInt(&m_currentCtrlMemItems);
   ++m_currentCtrlMemItems;
   t_opt->setMapped();
 }
 
+// The tail of a multi-cycle opt that wraps around the slots does not show
+// up before its first iteration starts.
 DFGNode* CGRANode::getMappedDFGNode(int t_cycle) {
-  for (pair<DFGNode*, int> p: *(m_dfgNodesWithOccupyStatus[t_cycle])) {
-    if (p.second == SINGLE_OCCUPY or p.second == END_PIPE_OCCUPY) {
-      return p.first;
+  for (FUOccupancy p: m_dfgNodesWithOccupyStatus[t_cycle%m_II]) {
+    if ((p.status == SINGLE_OCCUPY or p.status == END_PIPE_OCCUPY) and
+        p.firstCycle <= t_cycle) {
+      return p.dfgNode;
     }
   }
   return NULL;
 }
 
 bool CGRANode::containMappedDFGNode(DFGNode* t_node, int t_II) {
-  for (int c=0; c<2*t_II; ++c) {
-    for (pair<DFGNode*, int> p: *(m_dfgNodesWithOccupyStatus[c])) {
-      if (t_node == p.first) {
+  for (list<FUOccupancy>& slot: m_dfgNodesWithOccupyStatus) {
+    for (FUOccupancy p: slot) {
+      if (t_node == p.dfgNode and p.firstCycle < 2*t_II) {
         return true;
       }
     }
@@ -390,28 +423,24 @@ int CGRANode::getAvailableRegisterCount() {
 }
 
 CGRALink* CGRANode::getInLink(CGRANode* t_node) {
-  for (CGRALink* link: m_inLinks) {
-    if (link->getSrc() == t_node) {
-      return link;
-    }
-  }
+  int direction = getDirectionTo(t_node);
   // will definitely return one inlink
-  assert(0);
+  assert(direction != -1 and m_inLinkAt[direction] != NULL);
+  return m_inLinkAt[direction];
 }
 
 CGRALink* CGRANode::getOutLink(CGRANode* t_node) {
-  for (CGRALink* link: m_outLinks) {
-    if (link->getDst() == t_node)
-      return link;
-  }
-  return NULL;
-  // will definitely return one outlink
-//  assert(0);
+  int direction = getDirectionTo(t_node);
+  if (direction == -1)
+    return NULL;
+  return m_outLinkAt[direction];
 }
 
+// The occupancy repeats every II cycles, so there is no idle cycle if none
+// of the next II cycles is idle.
 int CGRANode::getMinIdleCycle(DFGNode* t_dfgNode, int t_cycle, int t_II) {
   int tempCycle = t_cycle;
-  while (tempCycle < m_cycleBoundary) {
+  while (tempCycle < m_cycleBoundary and tempCycle < t_cycle + t_II) {
     if (canOccupy(t_dfgNode, tempCycle, t_II))
       return tempCycle;
     ++tempCycle;
@@ -423,6 +452,10 @@ int CGRANode::getCurrentCtrlMemItems() {
   return m_currentCtrlMemItems;
 }
 
+int CGRANode::getCtrlMemSize() {
+  return m_ctrlMemSize;
+}
+
 // TODO: will support precision-based operations (e.g., fadd, fmul, etc).
 bool CGRANode::enableFunctionality(string t_func) {
   if (t_func.compare("store")) {
@@ -499,6 +532,10 @@ void CGRANode::disable() {
   }
 }
 
+bool CGRANode::isDisabled() {
+  return m_disabled;
+}
+
 void CGRANode::print_operations() {
 	for (auto op : *operations) {
 		std::cout << op << ", ";
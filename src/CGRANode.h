@@ -15,6 +15,8 @@
 #include "DFGNode.h"
 #include "OperationMap.h"
 #include "Options.h"
+#include "SlotBitset.h"
+#include "MappingTrail.h"
 #include <iostream>
 //#include <llvm/IR/Function.h>
 //#include <llvm/IR/Value.h>
@@ -31,6 +33,18 @@ using namespace llvm;
 class CGRALink;
 class DFGNode;
 
+// The directions a tile links to its neighbours, indexed by
+// CGRALink::getDirectionID() (N, S, W, E).
+#define CGRA_DIRECTIONS 4
+
+// An entry of the modulo reservation table of the functional unit. The
+// entry repeats every II cycles, starting from 'firstCycle'.
+struct FUOccupancy {
+  DFGNode* dfgNode;
+  int status;
+  int firstCycle;
+};
+
 class CGRANode {
 
   private:
@@ -46,11 +60,18 @@ class CGRANode {
     float* m_ctrlMem;
     list<CGRALink*> m_inLinks;
     list<CGRALink*> m_outLinks;
+    // The same links and the neighbours indexed by the direction, NULL
+    // where the tile has no link.
+    CGRALink* m_inLinkAt[CGRA_DIRECTIONS];
+    CGRALink* m_outLinkAt[CGRA_DIRECTIONS];
+    CGRANode* m_neighborAt[CGRA_DIRECTIONS];
     list<CGRALink*>* m_occupiableInLinks;
     list<CGRALink*>* m_occupiableOutLinks;
-    list<CGRANode*>* m_neighbors;
+    list<CGRANode*> m_neighbors;
 
-    // functional unit occupied with cycle going on
+    // functional unit occupied with cycle going on, the MRRG only keeps
+    // II slots and 'm_cycleBoundary' bounds the schedule horizon.
+    int m_II;
     int m_cycleBoundary;
     int* m_fuOccupied;
     DFGNode** m_dfgNodes;
@@ -62,13 +83,25 @@ class CGRANode {
     bool m_canCall;
     bool m_supportComplex;
 	bool m_build_cgra;
-    int** m_regs_duration;
+    // The slots each register holds a value for, and the port that writes
+    // each register in each slot.
+    vector<SlotBitset> m_regsOccupied;
     int** m_regs_timing;
-    vector<list<pair<DFGNode*, int>>*> m_dfgNodesWithOccupyStatus;
+    vector<list<FUOccupancy>> m_dfgNodesWithOccupyStatus;
+    // The slots where an opt (single-cycle or multi-cycle) starts or ends,
+    // so that most of the checks do not visit the opts.
+    SlotBitset m_fuStarted;
+    SlotBitset m_fuEnded;
+    void occupyFU(int, FUOccupancy);
 	list<OperationNumber> *operations;
+    // The same operations, interned, for canSupport().
+    OperationSet m_operationSet;
+    MappingTrail* m_trail;
 
   public:
     CGRANode(int, int, int, list<OperationNumber>*, Options*, Parameters*);
+    ~CGRANode();
+    void copyFunctionality(CGRANode*);
 //    CGRANode(int, int, int, int, int);
     void setRegConstraint(int);
     void setCtrlMemConstraint(int);
@@ -88,8 +121,11 @@ class CGRANode {
     CGRALink* getInLink(CGRANode*);
     CGRALink* getOutLink(CGRANode*);
     list<CGRANode*>* getNeighbors();
+    CGRANode* getNeighbor(int);
+    int getDirectionTo(CGRANode*);
 
     void constructMRRG(int, int);
+    void setTrail(MappingTrail*);
     bool canSupport(DFGNode*);
     bool isOccupied(int, int);
     // bool canOccupy(int, int);
@@ -102,6 +138,7 @@ class CGRANode {
     int getAvailableRegisterCount();
     int getMinIdleCycle(DFGNode*, int, int);
     int getCurrentCtrlMemItems();
+    int getCtrlMemSize();
     int getX();
     int getY();
     bool canReturn();
@@ -115,6 +152,7 @@ class CGRANode {
     void allocateReg(int, int, int, int);
     int* getRegsAllocation(int);
     void disable();
+    bool isDisabled();
 	void print_operations();
 };
 
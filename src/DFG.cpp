@@ -9,6 +9,7 @@
  */
 
 #include <fstream>
+#include <queue>
 #include "json.hpp"
 #include "DFG.h"
 #include "MapResult.h"
@@ -66,6 +67,8 @@ DFG::DFG(list<DFGNode *> nodes, list<DFGEdge*> edges): m_function(nullptr), node
   m_precisionAware = false;
   m_initPipelinedOpt = new list<string>();
   m_initExecLatency = new map<string, int>();
+  reindexNodes();
+  reindexDFGEdges();
 }
 
 DFG::DFG(std::string filename) {
@@ -97,7 +100,7 @@ DFG::DFG(std::string filename) {
   for (json node : j["nodes"]) {
     std::string node_name = node["name"].get<std::string>();
     DFGNode *n = new DFGNode(id ++, false, nullptr, node["operation"].get<std::string>(), node_name);
-    nodes.push_back(n);
+    addNode(n);
     node_name_lookup.insert({node_name, n});
   }
 
@@ -109,9 +112,13 @@ DFG::DFG(std::string filename) {
     DFGNode *fnode = node_name_lookup.at(edge["from"].get<std::string>());
 
     DFGEdge *thisEdge = new DFGEdge(id++, fnode, tnode);
+    // The optional "distance" is the iteration distance of a loop-carried
+    // edge.
+    if (edge.contains("distance"))
+      thisEdge->setIterationDistance(edge["distance"].get<int>());
     tnode->addInEdge(thisEdge);
     fnode->addOutEdge(thisEdge);
-    m_DFGEdges.push_back(thisEdge);
+    addDFGEdge(thisEdge);
     // todo --- The Json file has a "type" field to distinguish between
     // control edges and data edges.  Need to handle that.
   }
@@ -185,7 +192,7 @@ void DFG::tuneForPattern() {
       if (dfgNode->isPatternRoot()) {
         for (DFGNode* patternNode: *(dfgNode->getPatternNodes())) {
           if (hasDFGEdge(dfgNode, patternNode))
-            m_DFGEdges.remove(getDFGEdge(dfgNode, patternNode));
+            removeDFGEdge(getDFGEdge(dfgNode, patternNode));
           for (DFGNode* predNode: *(patternNode->getPredNodes())) {
             if (predNode == dfgNode or
                 predNode->isOneOfThem(dfgNode->getPatternNodes())) {
@@ -220,12 +227,27 @@ void DFG::tuneForPattern() {
     }
   }
   for (DFGNode* dfgNode: *removeNodes) {
-    nodes.remove(dfgNode);
+    removeNode(dfgNode);
   }
 }
 
 void DFG::removeNode(DFGNode *node) {
 	nodes.remove(node);
+	if (!node->hasValue())
+		return;
+	// Another node of the same value (e.g., a constant used twice) takes
+	// over in the index.
+	unordered_map<Value*, DFGNode*>::iterator iter =
+	    m_valueNodes.find(node->getValue());
+	if (iter != m_valueNodes.end() and iter->second == node) {
+		m_valueNodes.erase(iter);
+		for (DFGNode* other: nodes) {
+			if (other->hasValue() and other->getValue() == node->getValue()) {
+				m_valueNodes.emplace(other->getValue(), other);
+				break;
+			}
+		}
+	}
 }
 
 void DFG::removeNodes(list<DFGNode*> *nodes) {
@@ -443,11 +465,18 @@ void DFG::construct(Function *t_F) {
   m_DFGEdges.clear();
   nodes.clear();
   m_ctrlEdges.clear();
+  m_valueNodes.clear();
+  m_DFGEdgeIndex.clear();
+  m_ctrlEdgeIndex.clear();
 
   int nodeID = 0;
   int ctrlEdgeID = 0;
   int dfgEdgeID = 0;
 
+  // A CFG edge is a loop back edge if its target dominates its source, the
+  // DFG edges along it are loop-carried.
+  DominatorTree domTree(*t_F);
+
   errs()<<"*** current function: "<<t_F->getName()<<"\n";
 
   // FIXME: eleminate duplicated edges.
@@ -477,7 +506,7 @@ void DFG::construct(Function *t_F) {
         dfgNode = getNode(curII);
       } else {
         dfgNode = new DFGNode(nodeID++, m_precisionAware, curII, curII->getOpcodeName(), getValueName(curII));
-        nodes.push_back(dfgNode);
+        addNode(dfgNode);
 
 		// If there are any constant arguments to this DFG Node,
 		// we need to add those to the graph --- I think this
@@ -520,7 +549,7 @@ void DFG::construct(Function *t_F) {
         // This currently happens for fps or large int64_ts 
 				cnode = new DFGNode(nodeID ++, m_precisionAware, op, "Constant", "Constant");
         }
-				nodes.push_back(cnode);
+				addNode(cnode);
 			}
 		}
     // The operands are pushed on backwards --- don't think that this
@@ -556,7 +585,7 @@ void DFG::construct(Function *t_F) {
             dfgNode = getNode(inst);
           } else {
             dfgNode = new DFGNode(nodeID++, m_precisionAware, inst, inst->getOpcodeName(), getValueName(inst));
-            nodes.push_back(dfgNode);
+            addNode(dfgNode);
           }
     //      Instruction* first = &*(sucBB->begin());
     //      if (!getNode(inst)->isPhi()) {
@@ -576,8 +605,10 @@ void DFG::construct(Function *t_F) {
           else {
             ctrlEdge = new DFGEdge(ctrlEdgeID++, getNode(terminator), dfgNode, true);
 			  // errs() << "Built and added edge for node " << dfgNode->asString() << "\n";
-            m_ctrlEdges.push_back(ctrlEdge);
+            addCtrlEdge(ctrlEdge);
           }
+          if (domTree.dominates(sucBB, curBB))
+            ctrlEdge->setIterationDistance(1);
 		  // errs() << "Created edge " << ctrlEdge->asString() << "\n";
 
         }
@@ -670,6 +701,11 @@ void DFG::construct(Function *t_F) {
 //    }
 //  }
 
+  // The list has been reversed while adding the constants, the value of
+  // a constant used more than once maps to its first node in the final
+  // order.
+  reindexNodes();
+
   // Construct data flow edges.
   for (DFGNode* node: nodes) {
 //    nodes.push_back(Node(curII, getValueName(curII)));
@@ -690,7 +726,7 @@ void DFG::construct(Function *t_F) {
 			  dfgEdge = getDFGEdge(getNode(loadValPtr), node);
 			else {
 			  dfgEdge = new DFGEdge(dfgEdgeID++, getNode(loadValPtr), node);
-			  m_DFGEdges.push_back(dfgEdge);
+			  addDFGEdge(dfgEdge);
 			}
 	//        getNode(loadValPtr)->setOutEdge(dfgEdge);
 	//        (*nodeItr)->setInEdge(dfgEdge);
@@ -709,7 +745,7 @@ void DFG::construct(Function *t_F) {
 				dfgEdge1 = getDFGEdge(getNode(storeVal), node);
 			  else {
 				dfgEdge1 = new DFGEdge(dfgEdgeID++, getNode(storeVal), node);
-				m_DFGEdges.push_back(dfgEdge1);
+				addDFGEdge(dfgEdge1);
 			  }
 	//          getNode(storeVal)->setOutEdge(dfgEdge1);
 	//          (*nodeItr)->setInEdge(dfgEdge1);
@@ -722,7 +758,7 @@ void DFG::construct(Function *t_F) {
 			  else {
 	//            dfgEdge2 = new DFGEdge(dfgEdgeID++, *nodeItr, getNode(storeValPtr));
 				dfgEdge2 = new DFGEdge(dfgEdgeID++, getNode(storeValPtr), node);
-				m_DFGEdges.push_back(dfgEdge2);
+				addDFGEdge(dfgEdge2);
 			  }
 	//          getNode(storeValPtr)->setOutEdge(dfgEdge2);
 	//          (*nodeItr)->setInEdge(dfgEdge2);
@@ -746,7 +782,16 @@ void DFG::construct(Function *t_F) {
 					dfgEdge = getDFGEdge(getNode(tempInst), node);
 				  else {
 					dfgEdge = new DFGEdge(dfgEdgeID++, getNode(tempInst), node);
-					m_DFGEdges.push_back(dfgEdge);
+					addDFGEdge(dfgEdge);
+				  }
+				  // The value coming into a 'phi' through a back edge is
+				  // produced by the previous iteration.
+				  if (PHINode* phi = dyn_cast<PHINode>(curII)) {
+					for (unsigned i = 0; i < phi->getNumIncomingValues(); ++i) {
+					  if (phi->getIncomingValue(i) == tempInst and
+						  domTree.dominates(phi->getParent(), phi->getIncomingBlock(i)))
+						dfgEdge->setIterationDistance(1);
+					}
 				  }
 	//              getNode(tempInst)->setOutEdge(dfgEdge);
 	//              (*nodeItr)->setInEdge(dfgEdge);
@@ -788,102 +833,126 @@ void DFG::construct(Function *t_F) {
 }
 
 
-bool DFG::isMinimumAndHasNotBeenVisited(set<DFGNode*>* t_visited, map<DFGNode*, int>* t_map, DFGNode* t_node) {
-  if (t_visited->find(t_node) != t_visited->end()) {
-    return false;
-  }
-  for (DFGNode* e_node: nodes) {
-    if (e_node != t_node and t_visited->find(e_node) == t_visited->end() and (*t_map)[e_node] < (*t_map)[t_node]) {
-      return false;
-    }
-  }
-  return true;
-}
-
-// Reorder the DFG nodes based on the longest path.
+// Reorder the DFG nodes by level: the ASAP of a node over the edges of the
+// DFG including the loop-carried ones (see DFGLevels), in the current order
+// within a level. Linear in the size of the DFG, whereas enumerating the
+// simple paths for the longest one was exponential.
 void DFG::reorderInLongest() {
-  list<DFGNode*>* longestPath = new list<DFGNode*>();
-  list<DFGNode*>* currentPath = new list<DFGNode*>();
-  set<DFGNode*>* visited = new set<DFGNode*>();
-  map<DFGNode*, int> indegree;
-  for (DFGNode* node: nodes) {
-    indegree[node] = node->getPredNodes()->size();
-    currentPath->clear();
-    visited->clear();
-    reorderDFS(visited, longestPath, currentPath, node);
-  }
+  DFGLevels levels(&nodes, true);
+  for (DFGNode* node: nodes)
+    node->setLevel(levels.getASAP(node));
+  nodes.sort([](DFGNode* a, DFGNode* b) {
+    return a->getLevel() < b->getLevel();
+  });
+  reindexNodes();
+}
 
-  visited->clear();
-  int level = 0;
-  for (DFGNode* node: *longestPath) {
-    node->setLevel(level);
-    visited->insert(node);
-    //cout<<"check longest path node: "<<node->getID()<<endl;
-    for (DFGNode* succNode: *(node->getSuccNodes())) {
-      indegree[succNode] -= 1;
+// Orders the DFG nodes for mapping in the spirit of swing modulo
+// scheduling: the nodes on (or feeding) the most critical recurrence come
+// first, and each node right after the nodes it exchanges data with, the
+// least mobile (then the highest) one first. The mapper schedules a node
+// after its placed predecessors, including the ones of the previous
+// iteration, so the order is not made topological (a recurrence is best
+// entered at the node whose data comes the latest) and the levels of the
+// longest path order (see reorderInLongest()) still come first. The
+// criticality of a recurrence is its latency over its iteration distance,
+// as for the RecMII. The mobility, the height and the criticality only
+// follow the edges within the iteration (see DFGLevels). A node only gets
+// ahead when it turns adjacent, so it is queued again then and its stale
+// entry is skipped, the order takes O((N + E) log N).
+void DFG::getSMSOrderedNodes(list<DFGNode*>* t_order) {
+  DFGLevels levels(&nodes);
+  DFGAdjacency* adjacency = levels.getAdjacency();
+  vector<int>* topological = levels.getTopologicalOrder();
+  int nodeCount = adjacency->getNodeCount();
+
+  // The criticality of a node is the one of the most critical recurrence
+  // it is on or feeds.
+  vector<float> criticality(nodeCount, 0);
+  for (list<DFGNode*>* cycle: *m_cycleNodeLists) {
+    int latency = 0;
+    for (DFGNode* node: *cycle)
+      latency += node->getExecLatency();
+    float ratio = (float)latency / getIterationDistance(cycle);
+    for (DFGNode* node: *cycle) {
+      int i = adjacency->getIndex(node);
+      if (i != -1 and ratio > criticality[i])
+        criticality[i] = ratio;
     }
-    level += 1;
   }
-  int maxLevel = level;
-
-  while (visited->size() < nodes.size()) {
-    for (DFGNode* node: nodes) {
-      if (isMinimumAndHasNotBeenVisited(visited, &indegree, node)) {
-        level = 0;
-        for (DFGNode* preNode: *(node->getPredNodes())) {
-          if (level < preNode->getLevel() + 1) {
-            level = preNode->getLevel() + 1;
-          }
-        }
-        node->setLevel(level);
-        visited->insert(node);
-        for (DFGNode* succNode: *(node->getSuccNodes())) {
-          indegree[succNode] -= 1;
-        }
-      }
+  vector<int> rank(nodeCount);
+  for (int k=nodeCount-1; k>=0; --k) {
+    int u = (*topological)[k];
+    rank[u] = k;
+    for (int i=adjacency->getSuccBegin(u); i<adjacency->getSuccEnd(u); ++i) {
+      int v = adjacency->getSucc(i);
+      if (!levels.isBackEdge(i) and criticality[v] > criticality[u])
+        criticality[u] = criticality[v];
     }
   }
 
-  list<DFGNode*> tempNodes;
-  for (int l=0; l<maxLevel+1; ++l) {
-    for (DFGNode* node: nodes) {
-      if (node->getLevel() == l) {
-        tempNodes.push_back(node);
-      }
+  // An entry is a node and whether it was adjacent when it was queued.
+  auto precedes = [&](pair<int, bool> a, pair<int, bool> b) {
+    DFGNode* nodeA = adjacency->getNode(a.first);
+    DFGNode* nodeB = adjacency->getNode(b.first);
+    if (nodeA->getLevel() != nodeB->getLevel())
+      return nodeA->getLevel() < nodeB->getLevel();
+    if (criticality[a.first] != criticality[b.first])
+      return criticality[a.first] > criticality[b.first];
+    if (a.second != b.second)
+      return a.second;
+    if (levels.getMobility(a.first) != levels.getMobility(b.first))
+      return levels.getMobility(a.first) < levels.getMobility(b.first);
+    if (levels.getHeight(a.first) != levels.getHeight(b.first))
+      return levels.getHeight(a.first) > levels.getHeight(b.first);
+    return rank[a.first] < rank[b.first];
+  };
+  auto follows = [&](pair<int, bool> a, pair<int, bool> b) {
+    return precedes(b, a);
+  };
+  priority_queue<pair<int, bool>, vector<pair<int, bool>>,
+                 decltype(follows)> queue(follows);
+  for (int u=0; u<nodeCount; ++u)
+    queue.push(make_pair(u, false));
+  vector<bool> ordered(nodeCount, false);
+  vector<bool> adjacent(nodeCount, false);
+  auto setAdjacent = [&](int u) {
+    if (!ordered[u] and !adjacent[u]) {
+      adjacent[u] = true;
+      queue.push(make_pair(u, true));
     }
+  };
+  t_order->clear();
+  while (!queue.empty()) {
+    int next = queue.top().first;
+    queue.pop();
+    if (ordered[next])
+      continue;
+    ordered[next] = true;
+    t_order->push_back(adjacency->getNode(next));
+    for (int i=adjacency->getSuccBegin(next); i<adjacency->getSuccEnd(next); ++i)
+      setAdjacent(adjacency->getSucc(i));
+    for (int i=adjacency->getPredBegin(next); i<adjacency->getPredEnd(next); ++i)
+      setAdjacent(adjacency->getPred(i));
   }
-
-  nodes.clear();
-  // errs()<<"[reorder DFG along with the longest path]\n";
-  for (DFGNode* node: tempNodes) {
-    nodes.push_back(node);
-    // errs()<<"("<<node->getID()<<") "<<(node->asString())<<", level: "<<node->getLevel()<<"\n";
-  }
-
 }
 
-void DFG::reorderDFS(set<DFGNode*>* t_visited, list<DFGNode*>* t_targetPath,
-                     list<DFGNode*>* t_curPath, DFGNode* targetDFGNode) {
-
-  t_visited->insert(targetDFGNode);
-  t_curPath->push_back(targetDFGNode);
-
-  // Update target longest path if current one is longer.
-  if (t_curPath->size() > t_targetPath->size()) {
-    t_targetPath->clear();
-    for (DFGNode* node: *t_curPath) {
-      t_targetPath->push_back(node);
-    }
-  }
-
-  for (DFGNode* succNode: *(targetDFGNode->getSuccNodes())) {
-    if (t_visited->find(succNode) == t_visited->end()) { // not visited yet
-      reorderDFS(t_visited, t_targetPath, t_curPath, succNode);
-      t_visited->erase(succNode);
-      t_curPath->pop_back();
+// The iteration distance of a cycle listed along its edges (see
+// calculateCycles()): the sum over its edges, at least 1, as a cycle
+// without loop-carried edge is taken as one iteration.
+int DFG::getIterationDistance(list<DFGNode*>* t_cycle) {
+  int distance = 0;
+  DFGNode* prev = t_cycle->back();
+  for (DFGNode* node: *t_cycle) {
+    for (DFGEdge* edge: *(prev->getOutEdges())) {
+      if (edge->getDst() == node) {
+        distance += edge->getIterationDistance();
+        break;
+      }
     }
+    prev = node;
   }
-
+  return max(distance, 1);
 }
 
 void DFG::initExecLatency(map<string, int>* t_execLatency) {
@@ -986,11 +1055,13 @@ int DFG::getInstID(BasicBlock* t_bb, Value* t_inst) {
 }
 
 void DFG::addEdge(DFGEdge *edge) {
-	m_DFGEdges.push_back(edge);
+	addDFGEdge(edge);
 }
 
 void DFG::addNode(DFGNode *node) {
 	nodes.push_back(node);
+	if (node->hasValue())
+		m_valueNodes.emplace(node->getValue(), node);
 }
 
 void DFG::connectDFGNodes() {
@@ -1000,7 +1071,7 @@ void DFG::connectDFGNodes() {
   // Incorporate ctrl flow into data flow.
   if (!m_CDFGFused) {
     for (DFGEdge* edge: m_ctrlEdges) {
-      m_DFGEdges.push_back(edge);
+      addDFGEdge(edge);
     }
     m_CDFGFused = true;
   }
@@ -1134,72 +1205,181 @@ void DFG::generateDot(Function *t_F, bool t_isTrimmedDemo) {
 
 }
 
-void DFG::DFS_on_DFG(DFGNode* t_head, DFGNode* t_current,
-    list<DFGNode*>* t_visitedNodes, list<DFGEdge*>* t_erasedEdges,
-    list<DFGEdge*>* t_currentCycle, list<list<DFGEdge*>*>* t_cycles) {
-  for (DFGEdge* edge: m_DFGEdges) {
-    if (find(t_erasedEdges->begin(), t_erasedEdges->end(), edge) != t_erasedEdges->end())
+// The elementary cycles are enumerated up to this count, an unrolled loop
+// can have exponentially many of them.
+#define MAX_CYCLE_COUNT 4096
+
+// Tarjan's strongly connected components over the index-based adjacency
+// (iterative, to not overflow the stack on large DFGs). 't_components'
+// gets the component of each node.
+static void findComponents(vector<vector<int>>* t_succs,
+                           vector<int>* t_components) {
+  int nodeCount = t_succs->size();
+  vector<int> order(nodeCount, -1);
+  vector<int> lowLink(nodeCount, 0);
+  vector<bool> onStack(nodeCount, false);
+  vector<int> stack;
+  vector<pair<int, unsigned>> callStack;
+  t_components->assign(nodeCount, -1);
+  int visited = 0;
+  int componentCount = 0;
+  for (int root=0; root<nodeCount; ++root) {
+    if (order[root] != -1)
       continue;
-    // check whether the IR is equal
-    if (edge->getSrc() == t_current) {
-      // skip the visited nodes/edges:
-      if (find(t_currentCycle->begin(), t_currentCycle->end(), edge) != t_currentCycle->end()) {
+    callStack.push_back(make_pair(root, 0));
+    while (!callStack.empty()) {
+      int u = callStack.back().first;
+      unsigned next = callStack.back().second;
+      if (next == 0) {
+        order[u] = lowLink[u] = visited++;
+        stack.push_back(u);
+        onStack[u] = true;
+      }
+      if (next < (*t_succs)[u].size()) {
+        callStack.back().second = next + 1;
+        int v = (*t_succs)[u][next];
+        if (order[v] == -1)
+          callStack.push_back(make_pair(v, 0));
+        else if (onStack[v])
+          lowLink[u] = min(lowLink[u], order[v]);
         continue;
       }
-      t_currentCycle->push_back(edge);
-
-//      errs() << ".. add current cycle edge: {" << *edge->getSrc()->getInst() << "  } -> {"<< *edge->getDst()->getInst() << "  } ("<<edge->getSrc()->getID()<<" -> "<<edge->getDst()->getID()<<")\n";
-      if (edge->getDst() == t_head) {
-        // errs() << "==================================\n";
-        // errs() << "[detected one cycle] head: "<<*(t_head->getInst())<<"\n";
-        list<DFGEdge*>* temp_cycle = new list<DFGEdge*>();
-        for (DFGEdge* currentEdge: *t_currentCycle) {
-          temp_cycle->push_back(currentEdge);
-          // break the cycle to avoid future repeated detection
-          // errs() << "cycle edge: {" << *(currentEdge)->getSrc()->getInst() << "  } -> {"<< *(currentEdge)->getDst()->getInst() << "  } ("<<currentEdge->getSrc()->getID()<<" -> "<<currentEdge->getDst()->getID()<<")\n";
-        }
-        t_erasedEdges->push_back(edge);
-        t_cycles->push_back(temp_cycle);
-        t_currentCycle->remove(edge);
-      } else {
-        if (find(t_visitedNodes->begin(), t_visitedNodes->end(), edge->getDst()) == t_visitedNodes->end()) {
-          t_visitedNodes->push_back(edge->getDst());
-          // Only continue when the path size is less than the node count.
-          if (t_currentCycle->size() <= nodes.size()) {
-            DFS_on_DFG(t_head, edge->getDst(), t_visitedNodes, t_erasedEdges, t_currentCycle, t_cycles);
-          }
-        } else {
-          t_currentCycle->remove(edge);
-        }
+      callStack.pop_back();
+      if (!callStack.empty()) {
+        int parent = callStack.back().first;
+        lowLink[parent] = min(lowLink[parent], lowLink[u]);
+      }
+      if (lowLink[u] == order[u]) {
+        int v;
+        do {
+          v = stack.back();
+          stack.pop_back();
+          onStack[v] = false;
+          (*t_components)[v] = componentCount;
+        } while (v != u);
+        ++componentCount;
       }
     }
   }
-  if (t_currentCycle->size()!=0) {
-    t_currentCycle->pop_back();
+}
+
+// The state of Johnson's search for the cycles through 'start', which only
+// visits the nodes of the component of 'start' that come after it.
+struct CycleSearch {
+  vector<vector<int>>* succs;
+  vector<int>* components;
+  int start;
+  vector<bool> blocked;
+  vector<list<int>> blockedBy;
+  vector<int> path;
+  list<vector<int>>* cycles;
+};
+
+static void unblock(CycleSearch* t_search, int t_node) {
+  t_search->blocked[t_node] = false;
+  while (!t_search->blockedBy[t_node].empty()) {
+    int w = t_search->blockedBy[t_node].front();
+    t_search->blockedBy[t_node].pop_front();
+    if (t_search->blocked[w])
+      unblock(t_search, w);
   }
 }
 
+static bool findCircuits(CycleSearch* t_search, int t_node) {
+  bool found = false;
+  t_search->path.push_back(t_node);
+  t_search->blocked[t_node] = true;
+  for (int w: (*t_search->succs)[t_node]) {
+    if (w < t_search->start or
+        (*t_search->components)[w] != (*t_search->components)[t_search->start])
+      continue;
+    if ((int)t_search->cycles->size() >= MAX_CYCLE_COUNT)
+      break;
+    if (w == t_search->start) {
+      t_search->cycles->push_back(t_search->path);
+      found = true;
+    } else if (!t_search->blocked[w] and findCircuits(t_search, w)) {
+      found = true;
+    }
+  }
+  if (found) {
+    unblock(t_search, t_node);
+  } else {
+    for (int w: (*t_search->succs)[t_node]) {
+      if (w < t_search->start or
+          (*t_search->components)[w] != (*t_search->components)[t_search->start])
+        continue;
+      list<int>& blockedBy = t_search->blockedBy[w];
+      if (find(blockedBy.begin(), blockedBy.end(), t_node) == blockedBy.end())
+        blockedBy.push_back(t_node);
+    }
+  }
+  t_search->path.pop_back();
+  return found;
+}
+
+// Finds the elementary cycles of the DFG (up to MAX_CYCLE_COUNT) with
+// Johnson's algorithm inside each strongly connected component. Each cycle
+// is returned as its edges starting from its node of the smallest index,
+// and the nodes on the cycles are marked as critical with the cycle IDs.
 list<list<DFGEdge*>*>* DFG::calculateCycles() {
-  list<list<DFGEdge*>*>* cycleLists = new list<list<DFGEdge*>*>();
-  list<DFGEdge*>* currentCycle = new list<DFGEdge*>();
-  list<DFGNode*>* visitedNodes = new list<DFGNode*>();
-  list<DFGEdge*>* erasedEdges = new list<DFGEdge*>();
-  cycleLists->clear();
-  for (DFGNode* node: nodes) {
-    currentCycle->clear();
-    visitedNodes->clear();
-    visitedNodes->push_back(node);
-    DFS_on_DFG(node, node, visitedNodes, erasedEdges, currentCycle, cycleLists);
+  for (DFGNode* node: nodes)
+    node->clearCycleIDs();
+  DFGAdjacency adjacency(&nodes);
+  int nodeCount = adjacency.getNodeCount();
+  // One edge per pair of nodes is enough to tell the cycles.
+  vector<vector<int>> succs(nodeCount);
+  vector<vector<DFGEdge*>> succEdges(nodeCount);
+  vector<int> lastSource(nodeCount, -1);
+  for (int u=0; u<nodeCount; ++u) {
+    for (int i=adjacency.getSuccBegin(u); i<adjacency.getSuccEnd(u); ++i) {
+      int v = adjacency.getSucc(i);
+      if (lastSource[v] == u)
+        continue;
+      lastSource[v] = u;
+      succs[u].push_back(v);
+      succEdges[u].push_back(adjacency.getSuccEdge(i));
+    }
+  }
+
+  vector<int> components;
+  findComponents(&succs, &components);
+
+  list<vector<int>> cycles;
+  CycleSearch search;
+  search.succs = &succs;
+  search.components = &components;
+  search.cycles = &cycles;
+  for (int start=0; start<nodeCount; ++start) {
+    if ((int)cycles.size() >= MAX_CYCLE_COUNT)
+      break;
+    search.start = start;
+    search.blocked.assign(nodeCount, false);
+    search.blockedBy.assign(nodeCount, list<int>());
+    findCircuits(&search, start);
   }
+
+  list<list<DFGEdge*>*>* cycleLists = new list<list<DFGEdge*>*>();
   int cycleID = 0;
   m_cycleNodeLists->clear();
-  for (list<DFGEdge*>* cycle: *cycleLists) {
+  for (vector<int>& cycle: cycles) {
+    list<DFGEdge*>* edgeCycle = new list<DFGEdge*>();
     list<DFGNode*>* nodeCycle = new list<DFGNode*>();
-    for (DFGEdge* edge: *cycle) {
+    // The nodes are listed from the destination of the first edge, i.e.,
+    // the start node comes last.
+    for (unsigned i=0; i<cycle.size(); ++i) {
+      int next = cycle[(i + 1) % cycle.size()];
+      vector<int>& targets = succs[cycle[i]];
+      int position = find(targets.begin(), targets.end(), next) -
+                     targets.begin();
+      edgeCycle->push_back(succEdges[cycle[i]][position]);
+    }
+    for (DFGEdge* edge: *edgeCycle) {
       edge->getDst()->setCritical();
       edge->getDst()->addCycleID(cycleID);
       nodeCycle->push_back(edge->getDst());
     }
+    cycleLists->push_back(edgeCycle);
     m_cycleNodeLists->push_back(nodeCycle);
     cycleID += 1;
   }
@@ -1229,88 +1409,101 @@ int DFG::getID(DFGNode* t_node) {
 }
 
 DFGNode* DFG::getNode(Value* t_value) {
-  for (DFGNode* node: nodes) {
-    if (node->getValue() == t_value) {
-      return node;
-    }
-  }
+  unordered_map<Value*, DFGNode*>::iterator iter = m_valueNodes.find(t_value);
+  if (iter != m_valueNodes.end())
+    return iter->second;
   assert("ERROR cannot find the corresponding DFG node.");
   return NULL;
 }
 
 bool DFG::hasNode(Value* t_value) {
+  return m_valueNodes.find(t_value) != m_valueNodes.end();
+}
+
+// Rebuilds the value index after the node list is reordered.
+void DFG::reindexNodes() {
+  m_valueNodes.clear();
   for (DFGNode* node: nodes) {
-    if (node->getValue() == t_value) {
-      return true;
-    }
+    if (node->hasValue())
+      m_valueNodes.emplace(node->getValue(), node);
   }
-  return false;
 }
 
-DFGEdge* DFG::getCtrlEdge(DFGNode* t_src, DFGNode* t_dst) {
-  for (DFGEdge* edge: m_ctrlEdges) {
-    if (edge->getSrc() == t_src and
-        edge->getDst() == t_dst) {
-      return edge;
+void DFG::reindexDFGEdges() {
+  m_DFGEdgeIndex.clear();
+  for (DFGEdge* edge: m_DFGEdges)
+    m_DFGEdgeIndex.emplace(make_pair(edge->getSrc(), edge->getDst()), edge);
+}
+
+void DFG::addDFGEdge(DFGEdge* t_edge) {
+  m_DFGEdges.push_back(t_edge);
+  m_DFGEdgeIndex.emplace(make_pair(t_edge->getSrc(), t_edge->getDst()),
+                         t_edge);
+}
+
+// Another edge between the same nodes (if any) takes over in the index.
+void DFG::removeDFGEdge(DFGEdge* t_edge) {
+  m_DFGEdges.remove(t_edge);
+  pair<DFGNode*, DFGNode*> key(t_edge->getSrc(), t_edge->getDst());
+  DFGEdgeIndex::iterator iter = m_DFGEdgeIndex.find(key);
+  if (iter == m_DFGEdgeIndex.end() or iter->second != t_edge)
+    return;
+  m_DFGEdgeIndex.erase(iter);
+  for (DFGEdge* edge: m_DFGEdges) {
+    if (edge->getSrc() == key.first and edge->getDst() == key.second) {
+      m_DFGEdgeIndex.emplace(key, edge);
+      break;
     }
   }
+}
+
+void DFG::addCtrlEdge(DFGEdge* t_edge) {
+  m_ctrlEdges.push_back(t_edge);
+  m_ctrlEdgeIndex.emplace(make_pair(t_edge->getSrc(), t_edge->getDst()),
+                          t_edge);
+}
+
+DFGEdge* DFG::getCtrlEdge(DFGNode* t_src, DFGNode* t_dst) {
+  DFGEdgeIndex::iterator iter = m_ctrlEdgeIndex.find(make_pair(t_src, t_dst));
+  if (iter != m_ctrlEdgeIndex.end())
+    return iter->second;
   assert("ERROR cannot find the corresponding Ctrl edge.");
   return NULL;
 }
 
 bool DFG::hasCtrlEdge(DFGNode* t_src, DFGNode* t_dst) {
-  for (DFGEdge* edge: m_ctrlEdges) {
-    if (edge->getSrc() == t_src and
-        edge->getDst() == t_dst) {
-      return true;
-    }
-  }
-  return false;
+  return m_ctrlEdgeIndex.find(make_pair(t_src, t_dst)) !=
+         m_ctrlEdgeIndex.end();
 }
 
 DFGEdge* DFG::getDFGEdge(DFGNode* t_src, DFGNode* t_dst) {
-  for (DFGEdge* edge: m_DFGEdges) {
-    if (edge->getSrc() == t_src and
-        edge->getDst() == t_dst) {
-      return edge;
-    }
-
-  }
+  DFGEdgeIndex::iterator iter = m_DFGEdgeIndex.find(make_pair(t_src, t_dst));
+  if (iter != m_DFGEdgeIndex.end())
+    return iter->second;
   assert("ERROR cannot find the corresponding DFG edge.");
   return NULL;
 }
 
 void DFG::replaceDFGEdge(DFGNode* t_old_src, DFGNode* t_old_dst,
                          DFGNode* t_new_src, DFGNode* t_new_dst) {
-  DFGEdge* target = NULL;
   // errs()<<"replace edge: [delete] "<<t_old_src->getID()<<"->"<<t_old_dst->getID()<<" [new] "<<t_new_src->getID()<<"->"<<t_new_dst->getID()<<"\n";
-  for (DFGEdge* edge: m_DFGEdges) {
-    if (edge->getSrc() == t_old_src and
-        edge->getDst() == t_old_dst) {
-      target = edge;
-      break;
-    }
-  }
+  DFGEdge* target = getDFGEdge(t_old_src, t_old_dst);
   if (target == NULL)
     assert("ERROR cannot find the corresponding DFG edge.");
-  m_DFGEdges.remove(target);
+  removeDFGEdge(target);
   DFGEdge* newEdge = new DFGEdge(target->getID(), t_new_src, t_new_dst);
-  m_DFGEdges.push_back(newEdge);
+  newEdge->setIterationDistance(target->getIterationDistance());
+  addDFGEdge(newEdge);
 }
 
 void DFG::deleteDFGEdge(DFGNode* t_src, DFGNode* t_dst) {
   if (!hasDFGEdge(t_src, t_dst)) return;
-  m_DFGEdges.remove(getDFGEdge(t_src, t_dst));
+  removeDFGEdge(getDFGEdge(t_src, t_dst));
 }
 
 bool DFG::hasDFGEdge(DFGNode* t_src, DFGNode* t_dst) {
-  for (DFGEdge* edge: m_DFGEdges) {
-    if (edge->getSrc() == t_src and
-        edge->getDst() == t_dst) {
-      return true;
-    }
-  }
-  return false;
+  return m_DFGEdgeIndex.find(make_pair(t_src, t_dst)) !=
+         m_DFGEdgeIndex.end();
 }
 
 string DFG::changeIns2Str(Value* t_ins) {
@@ -1356,6 +1549,9 @@ void DFG::tuneForBitcast() {
         for (DFGNode* predNode: *predNodes) {
           DFGEdge* bypassDFGEdge = new DFGEdge(predNode->getID(),
               predNode, succNode);
+          bypassDFGEdge->setIterationDistance(
+              getDFGEdge(predNode, dfgNode)->getIterationDistance() +
+              getDFGEdge(dfgNode, succNode)->getIterationDistance());
           newDFGEdges.push_back(bypassDFGEdge);
         }
       }
@@ -1363,13 +1559,13 @@ void DFG::tuneForBitcast() {
   }
 
   for (DFGNode* dfgNode: unnecessaryDFGNodes)
-    nodes.remove(dfgNode);
+    removeNode(dfgNode);
 
   for (DFGEdge* dfgEdge: replaceDFGEdges)
-    m_DFGEdges.remove(dfgEdge);
+    removeDFGEdge(dfgEdge);
 
   for (DFGEdge* dfgEdge: newDFGEdges)
-    m_DFGEdges.push_back(dfgEdge);
+    addDFGEdge(dfgEdge);
 
   connectDFGNodes();
 }
@@ -1500,6 +1696,10 @@ void DFG::rejoinCycles() {
 
 		// New edge: (IIRC the edge IDs don't matter?)
 		DFGEdge *newEdge = new DFGEdge(0, sourceEdge->getSrc(), destEdge->getDst());
+		// The edges broken for the rewriter close the cycles, so they are
+		// taken as loop-carried (the distance itself is lost in the round
+		// trip through the rewriter).
+		newEdge->setIterationDistance(1);
 
 		// Put this edge into the nodes:
 		sourceNode->addOutEdge(newEdge);
@@ -1518,7 +1718,7 @@ void DFG::rejoinCycles() {
 	removeNodes(&nodesToDelete);
 	// remove all nodes from the edges list:
 	for (DFGEdge *edge : edgesToDelete) {
-		m_DFGEdges.remove(edge);
+		removeDFGEdge(edge);
 
 		// Need to clear the edge from the nodes it was
 		// attached to also:
@@ -1685,6 +1885,7 @@ void DFG::tuneForLoad() {
             removeDFGEdges.push_back(removeEdge);
             DFGEdge* newDFGEdge = new DFGEdge(removeEdge->getID(),
                 firstLoadNode, succOfLoad);
+            newDFGEdge->setIterationDistance(removeEdge->getIterationDistance());
             newDFGEdges.push_back(newDFGEdge);
           }
         }
@@ -1693,13 +1894,13 @@ void DFG::tuneForLoad() {
   }
 
   for (DFGNode* dfgNode: unnecessaryDFGNodes)
-    nodes.remove(dfgNode);
+    removeNode(dfgNode);
 
   for (DFGEdge* dfgEdge: removeDFGEdges)
-    m_DFGEdges.remove(dfgEdge);
+    removeDFGEdge(dfgEdge);
 
   for (DFGEdge* dfgEdge: newDFGEdges)
-    m_DFGEdges.push_back(dfgEdge);
+    addDFGEdge(dfgEdge);
 
   connectDFGNodes();
 }
@@ -1728,9 +1929,9 @@ void DFG::tuneForBranch() {
       for (DFGNode* predDFGNode: *(left->getPredNodes())) {
         DFGEdge* newDFGBrEdge = new DFGEdge(newDFGEdgeID++,
             predDFGNode, newDFGBrNode);
-        m_DFGEdges.push_back(newDFGBrEdge);
+        addDFGEdge(newDFGBrEdge);
       }
-      nodes.push_back(newDFGBrNode);
+      addNode(newDFGBrNode);
       left = newDFGBrNode;
     }
     list<DFGNode*>* predNodes = right->getPredNodes();
@@ -1738,6 +1939,11 @@ void DFG::tuneForBranch() {
       DFGEdge* replaceDFGEdge = getDFGEdge(predNode, right);
       DFGEdge* brDataDFGEdge = new DFGEdge(replaceDFGEdge->getID(), predNode, left);
       DFGEdge* brCtrlDFGEdge = new DFGEdge(newDFGEdgeID++, left, right);
+      // Both the data and the control now reach the 'phi' through the
+      // 'br', which carries the iteration distance of either.
+      brCtrlDFGEdge->setIterationDistance(
+          max(replaceDFGEdge->getIterationDistance(),
+              dfgEdge->getIterationDistance()));
       // FIXME: Only consider one predecessor for 'phi' node for now.
       //        Need to care about true/false and make proper connection.
       replaceDFGEdges.push_back(replaceDFGEdge);
@@ -1747,10 +1953,10 @@ void DFG::tuneForBranch() {
     }
   }
   for (DFGEdge* dfgEdge: replaceDFGEdges) {
-    m_DFGEdges.remove(dfgEdge);
+    removeDFGEdge(dfgEdge);
   }
   for (DFGEdge* dfgEdge: newBrDFGEdges) {
-    m_DFGEdges.push_back(dfgEdge);
+    addDFGEdge(dfgEdge);
   }
 
   connectDFGNodes();
@@ -1781,7 +1987,7 @@ void DFG::trimForStandalone() {
       removeNodes.push_back(dfgNode);
 
   for (DFGNode* dfgNode: removeNodes)
-    nodes.remove(dfgNode);
+    removeNode(dfgNode);
 }
 
 bool DFG::searchDFS(DFGNode* t_target, DFGNode* t_head,
@@ -1820,50 +2026,27 @@ OperationNumber DFG::getOperation() {
   return m_function->getName().data();
 }
 
-// Return the shortest path from t_src to t_dst, not only following succs.
-int getShortestForwardPath(DFGNode* t_src, DFGNode* t_dst) {
-  set<DFGNode*> visitedNodes;
-  list<DFGNode*> toVisit;
-  list<int> distances;
+#define UNREACHABLE_DISTANCE 1000000000
 
+// Fills 't_distances' with the number of edges on the shortest forward
+// path from 't_src' to every node (breadth-first over the successors).
+static void getForwardDistances(DFGAdjacency* t_adjacency, int t_src,
+                                vector<int>* t_distances) {
+  t_distances->assign(t_adjacency->getNodeCount(), UNREACHABLE_DISTANCE);
+  vector<int> toVisit;
   toVisit.push_back(t_src);
-  distances.push_back(0);
-  bool found = false;
-  int foundDistance = 0;
-
-  while (toVisit.size() > 0 && !found) {
-    DFGNode* curNode = toVisit.front();
-    toVisit.pop_front();
-    int curDistance = distances.front();
-    distances.pop_front();
-    if (curNode == t_dst) {
-      found = true;
-      foundDistance = curDistance;
-      break;
-    }
-    visitedNodes.insert(curNode);
-    for (DFGNode* succNode: *(curNode->getSuccNodes())) {
-      if (visitedNodes.find(succNode) == visitedNodes.end()) {
-        toVisit.push_back(succNode);
-        distances.push_back(curDistance + 1);
+  (*t_distances)[t_src] = 0;
+  for (unsigned head=0; head<toVisit.size(); ++head) {
+    int current = toVisit[head];
+    for (int i=t_adjacency->getSuccBegin(current);
+         i<t_adjacency->getSuccEnd(current); ++i) {
+      int succ = t_adjacency->getSucc(i);
+      if ((*t_distances)[succ] == UNREACHABLE_DISTANCE) {
+        (*t_distances)[succ] = (*t_distances)[current] + 1;
+        toVisit.push_back(succ);
       }
     }
   }
-
-  if (found)
-    return foundDistance;
-  else
-    return 1000000000;
-}
-
-int getShortestPath(DFGNode* t_src, DFGNode* t_dst) {
-  int shortestPathBefore = getShortestForwardPath(t_src, t_dst);
-  int shortestPathAfter = getShortestForwardPath(t_dst, t_src);
-
-  if (shortestPathBefore < shortestPathAfter)
-    return shortestPathBefore;
-  else
-    return shortestPathAfter;
 }
 
 json DFG::computeFrequencies() {
@@ -1884,9 +2067,17 @@ json DFG::computeFrequencies() {
 json DFG::computeDistances() {
   json result;
 
-  for (DFGNode* dfgNode: nodes) {
+  // The shortest path between two nodes follows the succs in either
+  // direction, so the forward distances from every node are enough.
+  DFGAdjacency adjacency(&nodes);
+  int nodeCount = adjacency.getNodeCount();
+  vector<vector<int>> distances(nodeCount);
+  for (int i=0; i<nodeCount; ++i)
+    getForwardDistances(&adjacency, i, &distances[i]);
+
+  for (int i=0; i<nodeCount; ++i) {
     // Get the operation of this node:
-    std::string node_op = dfgNode->getOpcodeName();
+    std::string node_op = adjacency.getNode(i)->getOpcodeName();
     // errs() << "node_op: " << node_op << "\n";
     if (!result.contains(node_op)) {
       json sub_dict = json::object();
@@ -1894,27 +2085,22 @@ json DFG::computeDistances() {
     }
 
     // Now, get the distances (forward and backward to every other node)
-    for (DFGNode *otherNode : nodes) {
-      if (otherNode == dfgNode) {
+    for (int j=0; j<nodeCount; ++j) {
+      if (j == i) {
         continue;
       }
 
       // If the nodes are not equal, get the shortest path
-      int pathDistance = getShortestPath(dfgNode, otherNode);
-      std::string otherName = otherNode->getOpcodeName();
+      int pathDistance = min(distances[i][j], distances[j][i]);
+      std::string otherName = adjacency.getNode(j)->getOpcodeName();
       if (!result[node_op].contains(otherName)) {
-        // errs() << "otherName: " << otherName << "\n";
-        // errs() << "Json is " << result[node_op].dump() << "\n";
         result[node_op][otherName] = json::array();
-        // errs() << "Json (after set) is " << result[node_op].dump() << "\n";
       }
 
-      // errs() << "Json is " << result[node_op].dump() << " for name " << node_op << " and name " << otherName << "\n";
-      if (pathDistance < 1000000000) {
+      if (pathDistance < UNREACHABLE_DISTANCE) {
         // If there was no path, don't add.
         result[node_op][otherName].push_back(pathDistance);
       }
-      // errs() << "Json is " << result[node_op].dump() << "\n";
     }
   }
 
@@ -20,15 +20,20 @@
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/IR/Use.h>
+#include <llvm/IR/Dominators.h>
 #include <llvm/Analysis/CFG.h>
 #include <llvm/Analysis/LoopInfo.h>
 #include <list>
 #include <set>
+#include <vector>
 #include <map>
+#include <unordered_map>
 #include <iostream>
 
 #include "DFGNode.h"
 #include "DFGEdge.h"
+#include "DFGAdjacency.h"
+#include "DFGLevels.h"
 #include "OperationMap.h"
 #include "json.hpp"
 #include "Options.h"
@@ -37,6 +42,16 @@ using namespace llvm;
 using namespace std;
 using nlohmann::json;
 
+struct DFGNodePairHash {
+  size_t operator()(const pair<DFGNode*, DFGNode*>& t_pair) const {
+    return hash<DFGNode*>()(t_pair.first) * 31 +
+           hash<DFGNode*>()(t_pair.second);
+  }
+};
+
+typedef unordered_map<pair<DFGNode*, DFGNode*>, DFGEdge*, DFGNodePairHash>
+    DFGEdgeIndex;
+
 class DFG {
   private:
     int m_num;
@@ -51,6 +66,13 @@ class DFG {
     list<DFGEdge*> m_DFGEdges;
     list<DFGEdge*> m_ctrlEdges;
 
+    // Hash indices over the nodes and the edges above, so that looking up
+    // the node of an IR value or the edge between two nodes does not scan
+    // the lists. Like the scans, they give the first match in list order.
+    unordered_map<Value*, DFGNode*> m_valueNodes;
+    DFGEdgeIndex m_DFGEdgeIndex;
+    DFGEdgeIndex m_ctrlEdgeIndex;
+
 	// Just some stuff to allow cloning
 	list<string> *m_initPipelinedOpt;
 	map<string, int> *m_initExecLatency;
@@ -58,10 +80,13 @@ class DFG {
     string changeIns2Str(Value* ins);
     //get value's name or inst's content
     StringRef getValueName(Value* v);
-    void DFS_on_DFG(DFGNode*, DFGNode*, list<DFGNode*>*, list<DFGEdge*>*,
-        list<DFGEdge*>*, list<list<DFGEdge*>*>*);
     DFGNode* getNode(Value*);
     bool hasNode(Value*);
+    void reindexNodes();
+    void reindexDFGEdges();
+    void addDFGEdge(DFGEdge*);
+    void removeDFGEdge(DFGEdge*);
+    void addCtrlEdge(DFGEdge*);
     DFGEdge* getDFGEdge(DFGNode*, DFGNode*);
     void deleteDFGEdge(DFGNode*, DFGNode*);
     void replaceDFGEdge(DFGNode*, DFGNode*, DFGNode*, DFGNode*);
@@ -91,11 +116,8 @@ class DFG {
     // void reorderInASAP();
     // void reorderInALAP();
     void reorderInLongest();
-    void reorderDFS(set<DFGNode*>*, list<DFGNode*>*,
-                    list<DFGNode*>*, DFGNode*);
     void initExecLatency(map<string, int>*);
     void initPipelinedOpt(list<string>*);
-    bool isMinimumAndHasNotBeenVisited(set<DFGNode*>*, map<DFGNode*, int>*, DFGNode*);
 
   public:
 	DFG(DFG &old);
@@ -108,6 +130,7 @@ class DFG {
 
     list<DFGNode*>* getBFSOrderedNodes();
     list<DFGNode*>* getDFSOrderedNodes();
+    void getSMSOrderedNodes(list<DFGNode*>*);
     int getNodeCount();
     void construct(Function*);
     void setupCycles();
@@ -115,6 +138,7 @@ class DFG {
 	void rejoinCycles();
     list<list<DFGEdge*>*>* calculateCycles();
     list<list<DFGNode*>*>* getCycleLists();
+    int getIterationDistance(list<DFGNode*>*);
     int getID(DFGNode*);
     bool isLoad(DFGNode*);
     bool isStore(DFGNode*);
@@ -0,0 +1,88 @@
+/*
+ * ======================================================================
+ * DFGAdjacency.cpp
+ * ======================================================================
+ * Compact adjacency of the DFG.
+ */
+
+#include "DFGAdjacency.h"
+
+DFGAdjacency::DFGAdjacency(list<DFGNode*>* t_nodes) {
+  m_nodes.assign(t_nodes->begin(), t_nodes->end());
+  m_indices.reserve(m_nodes.size());
+  for (unsigned i=0; i<m_nodes.size(); ++i)
+    m_indices.emplace(m_nodes[i], i);
+
+  m_succOffsets.push_back(0);
+  m_predOffsets.push_back(0);
+  for (DFGNode* node: m_nodes) {
+    for (DFGEdge* edge: *(node->getOutEdges())) {
+      int dst = getIndex(edge->getDst());
+      if (dst == -1)
+        continue;
+      m_succs.push_back(dst);
+      m_succEdges.push_back(edge);
+    }
+    m_succOffsets.push_back(m_succs.size());
+    for (DFGEdge* edge: *(node->getInEdges())) {
+      int src = getIndex(edge->getSrc());
+      if (src == -1)
+        continue;
+      m_preds.push_back(src);
+      m_predEdges.push_back(edge);
+    }
+    m_predOffsets.push_back(m_preds.size());
+  }
+}
+
+int DFGAdjacency::getNodeCount() {
+  return m_nodes.size();
+}
+
+int DFGAdjacency::getEdgeCount() {
+  return m_succs.size();
+}
+
+DFGNode* DFGAdjacency::getNode(int t_index) {
+  return m_nodes[t_index];
+}
+
+// Returns -1 if the node is not in the snapshot.
+int DFGAdjacency::getIndex(DFGNode* t_node) {
+  unordered_map<DFGNode*, int>::iterator iter = m_indices.find(t_node);
+  if (iter == m_indices.end())
+    return -1;
+  return iter->second;
+}
+
+int DFGAdjacency::getSuccBegin(int t_index) {
+  return m_succOffsets[t_index];
+}
+
+int DFGAdjacency::getSuccEnd(int t_index) {
+  return m_succOffsets[t_index + 1];
+}
+
+int DFGAdjacency::getSucc(int t_position) {
+  return m_succs[t_position];
+}
+
+DFGEdge* DFGAdjacency::getSuccEdge(int t_position) {
+  return m_succEdges[t_position];
+}
+
+int DFGAdjacency::getPredBegin(int t_index) {
+  return m_predOffsets[t_index];
+}
+
+int DFGAdjacency::getPredEnd(int t_index) {
+  return m_predOffsets[t_index + 1];
+}
+
+int DFGAdjacency::getPred(int t_position) {
+  return m_preds[t_position];
+}
+
+DFGEdge* DFGAdjacency::getPredEdge(int t_position) {
+  return m_predEdges[t_position];
+}
@@ -0,0 +1,53 @@
+/*
+ * ======================================================================
+ * DFGAdjacency.h
+ * ======================================================================
+ * Compact adjacency of the DFG header file.
+ */
+
+#ifndef DFGAdjacency_H
+#define DFGAdjacency_H
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "DFGNode.h"
+#include "DFGEdge.h"
+
+using namespace std;
+
+// A read-only snapshot of the DFG for the analyses that walk the whole
+// graph. The nodes get dense indices in the order of the given list, and
+// the edges between them are stored in CSR form: the successors of node i
+// are at [getSuccBegin(i), getSuccEnd(i)) of one contiguous array (same
+// for the predecessors), in the order of the out (in) edges of the node.
+// Edges to nodes that are not in the list are left out. The snapshot is
+// not updated when the DFG changes, it is meant to be rebuilt instead.
+class DFGAdjacency {
+  private:
+    vector<DFGNode*> m_nodes;
+    unordered_map<DFGNode*, int> m_indices;
+    vector<int> m_succOffsets;
+    vector<int> m_succs;
+    vector<DFGEdge*> m_succEdges;
+    vector<int> m_predOffsets;
+    vector<int> m_preds;
+    vector<DFGEdge*> m_predEdges;
+
+  public:
+    DFGAdjacency(list<DFGNode*>*);
+    int getNodeCount();
+    int getEdgeCount();
+    DFGNode* getNode(int);
+    int getIndex(DFGNode*);
+    int getSuccBegin(int);
+    int getSuccEnd(int);
+    int getSucc(int);
+    DFGEdge* getSuccEdge(int);
+    int getPredBegin(int);
+    int getPredEnd(int);
+    int getPred(int);
+    DFGEdge* getPredEdge(int);
+};
+
+#endif
@@ -16,6 +16,7 @@ DFGEdge::DFGEdge(int t_id, DFGNode* t_src, DFGNode* t_dst) {
   m_src = t_src;
   m_dst = t_dst;
   m_isCtrlEdge = false;
+  m_iterationDistance = 0;
 }
 
 DFGEdge::DFGEdge(int t_id, DFGNode* t_src, DFGNode* t_dst, bool t_isCtrlEdge) {
@@ -23,6 +24,7 @@ DFGEdge::DFGEdge(int t_id, DFGNode* t_src, DFGNode* t_dst, bool t_isCtrlEdge) {
   m_src = t_src;
   m_dst = t_dst;
   m_isCtrlEdge = t_isCtrlEdge;
+  m_iterationDistance = 0;
   m_src->addPredicatee(m_dst);
 }
 
@@ -82,3 +84,12 @@ bool DFGEdge::isCtrlEdge() {
   return m_isCtrlEdge;
 }
 
+// The number of iterations the data (or control) travels along the edge,
+// i.e., 1 for a loop-carried dependence and 0 within the same iteration.
+void DFGEdge::setIterationDistance(int t_iterationDistance) {
+  m_iterationDistance = t_iterationDistance;
+}
+
+int DFGEdge::getIterationDistance() {
+  return m_iterationDistance;
+}
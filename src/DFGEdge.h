@@ -28,6 +28,7 @@ class DFGEdge
     DFGNode *m_src;
     DFGNode *m_dst;
     bool m_isCtrlEdge;
+    int m_iterationDistance;
 
   public:
     DFGEdge(int, DFGNode*, DFGNode*);
@@ -42,6 +43,8 @@ class DFGEdge
     void connect(DFGNode*, DFGNode*);
     DFGNode* getConnectedNode(DFGNode*);
     bool isCtrlEdge();
+    void setIterationDistance(int);
+    int getIterationDistance();
 	std::string asString();
 };
 
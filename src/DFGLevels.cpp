@@ -0,0 +1,149 @@
+/*
+ * ======================================================================
+ * DFGLevels.cpp
+ * ======================================================================
+ * ASAP/ALAP levels of the DFG nodes.
+ */
+
+#include "DFGLevels.h"
+#include <algorithm>
+
+DFGLevels::DFGLevels(list<DFGNode*>* t_nodes, bool t_followCarried)
+    : m_adjacency(t_nodes) {
+  int nodeCount = m_adjacency.getNodeCount();
+  m_isBackEdge.assign(m_adjacency.getEdgeCount(), false);
+  for (int u=0; u<nodeCount; ++u) {
+    for (int i=m_adjacency.getSuccBegin(u); i<m_adjacency.getSuccEnd(u); ++i) {
+      if (m_adjacency.getSuccEdge(i)->getIterationDistance() > 0)
+        m_isBackEdge[i] = !t_followCarried or m_adjacency.getSucc(i) == u;
+    }
+  }
+
+  // Iterative DFS: the edge to a node that is still on the stack closes a
+  // cycle. The reverse postorder is a topological order of the rest. The
+  // DFS starts from the sources and takes the loop-carried edges of a
+  // node after the others, so that a recurrence is entered from outside
+  // and closed at the edges from its head.
+  vector<int> visit(m_adjacency.getEdgeCount());
+  vector<int> roots;
+  for (int u=0; u<nodeCount; ++u) {
+    int k = m_adjacency.getSuccBegin(u);
+    for (int pass=0; pass<2; ++pass) {
+      for (int i=m_adjacency.getSuccBegin(u); i<m_adjacency.getSuccEnd(u);
+           ++i) {
+        if ((m_adjacency.getSuccEdge(i)->getIterationDistance() > 0) == pass)
+          visit[k++] = i;
+      }
+    }
+    if (m_adjacency.getPredBegin(u) == m_adjacency.getPredEnd(u))
+      roots.push_back(u);
+  }
+  for (int u=0; u<nodeCount; ++u)
+    roots.push_back(u);
+  vector<int> state(nodeCount, 0);
+  vector<int> next(nodeCount);
+  vector<int> stack;
+  for (int root: roots) {
+    if (state[root] != 0)
+      continue;
+    state[root] = 1;
+    next[root] = m_adjacency.getSuccBegin(root);
+    stack.push_back(root);
+    while (!stack.empty()) {
+      int u = stack.back();
+      if (next[u] == m_adjacency.getSuccEnd(u)) {
+        state[u] = 2;
+        m_order.push_back(u);
+        stack.pop_back();
+        continue;
+      }
+      int position = visit[next[u]++];
+      int v = m_adjacency.getSucc(position);
+      if (m_isBackEdge[position])
+        continue;
+      if (state[v] == 1) {
+        m_isBackEdge[position] = true;
+      } else if (state[v] == 0) {
+        state[v] = 1;
+        next[v] = m_adjacency.getSuccBegin(v);
+        stack.push_back(v);
+      }
+    }
+  }
+  reverse(m_order.begin(), m_order.end());
+
+  m_asap.assign(nodeCount, 0);
+  m_height.assign(nodeCount, 0);
+  for (int u: m_order) {
+    int latency = m_adjacency.getNode(u)->getExecLatency();
+    for (int i=m_adjacency.getSuccBegin(u); i<m_adjacency.getSuccEnd(u); ++i) {
+      int v = m_adjacency.getSucc(i);
+      if (!m_isBackEdge[i] and m_asap[u] + latency > m_asap[v])
+        m_asap[v] = m_asap[u] + latency;
+    }
+  }
+  m_length = 0;
+  for (int k=nodeCount-1; k>=0; --k) {
+    int u = m_order[k];
+    int latency = m_adjacency.getNode(u)->getExecLatency();
+    m_height[u] = latency;
+    for (int i=m_adjacency.getSuccBegin(u); i<m_adjacency.getSuccEnd(u); ++i) {
+      int v = m_adjacency.getSucc(i);
+      if (!m_isBackEdge[i] and m_height[v] + latency > m_height[u])
+        m_height[u] = m_height[v] + latency;
+    }
+    if (m_asap[u] + m_height[u] > m_length)
+      m_length = m_asap[u] + m_height[u];
+  }
+}
+
+DFGAdjacency* DFGLevels::getAdjacency() {
+  return &m_adjacency;
+}
+
+// Whether the edge at the successor position 't_position' of the
+// adjacency is left out.
+bool DFGLevels::isBackEdge(int t_position) {
+  return m_isBackEdge[t_position];
+}
+
+// The node indices of the adjacency, in a topological order.
+vector<int>* DFGLevels::getTopologicalOrder() {
+  return &m_order;
+}
+
+int DFGLevels::getLength() {
+  return m_length;
+}
+
+int DFGLevels::getASAP(int t_index) {
+  return m_asap[t_index];
+}
+
+int DFGLevels::getALAP(int t_index) {
+  return m_length - m_height[t_index];
+}
+
+int DFGLevels::getHeight(int t_index) {
+  return m_height[t_index];
+}
+
+int DFGLevels::getMobility(int t_index) {
+  return getALAP(t_index) - getASAP(t_index);
+}
+
+int DFGLevels::getASAP(DFGNode* t_node) {
+  return getASAP(m_adjacency.getIndex(t_node));
+}
+
+int DFGLevels::getALAP(DFGNode* t_node) {
+  return getALAP(m_adjacency.getIndex(t_node));
+}
+
+int DFGLevels::getHeight(DFGNode* t_node) {
+  return getHeight(m_adjacency.getIndex(t_node));
+}
+
+int DFGLevels::getMobility(DFGNode* t_node) {
+  return getMobility(m_adjacency.getIndex(t_node));
+}
@@ -0,0 +1,59 @@
+/*
+ * ======================================================================
+ * DFGLevels.h
+ * ======================================================================
+ * ASAP/ALAP levels of the DFG nodes header file.
+ */
+
+#ifndef DFGLevels_H
+#define DFGLevels_H
+
+#include <list>
+#include <vector>
+#include "DFGNode.h"
+#include "DFGAdjacency.h"
+
+using namespace std;
+
+// The schedule priorities of the DFG nodes, computed in time linear in the
+// size of the DFG. The back edges are left out: the loop-carried edges
+// (with an iteration distance), and the edges that close a cycle without
+// one, found by a DFS from the sources. What is left is acyclic, and along
+// a topological order of it:
+//   - the ASAP of a node is the longest path (in execution latencies) from
+//     a source to it,
+//   - its height is the longest path from it to the end of a sink,
+//   - the length is the longest path of the DFG, the ALAP of a node is
+//     the length minus its height and the mobility the ALAP minus the ASAP
+//     (0 on the longest paths).
+// With 't_followCarried', the loop-carried edges are kept (but the
+// self-loops) and the DFS takes them last, so the head of a recurrence
+// comes after the source of its loop-carried edge, and the recurrences
+// are chained along the longest path as the mapper times them.
+// Like DFGAdjacency, the levels are not updated when the DFG changes.
+class DFGLevels {
+  private:
+    DFGAdjacency m_adjacency;
+    vector<bool> m_isBackEdge;
+    vector<int> m_order;
+    vector<int> m_asap;
+    vector<int> m_height;
+    int m_length;
+
+  public:
+    DFGLevels(list<DFGNode*>*, bool t_followCarried=false);
+    DFGAdjacency* getAdjacency();
+    bool isBackEdge(int);
+    vector<int>* getTopologicalOrder();
+    int getLength();
+    int getASAP(int);
+    int getALAP(int);
+    int getHeight(int);
+    int getMobility(int);
+    int getASAP(DFGNode*);
+    int getALAP(DFGNode*);
+    int getHeight(DFGNode*);
+    int getMobility(DFGNode*);
+};
+
+#endif
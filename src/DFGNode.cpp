@@ -12,6 +12,24 @@
 #include "OperationMap.h"
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <unordered_map>
+
+// The kinds of a node, derived from its opcode name in initKinds().
+#define KIND_LOAD        (1u << 0)
+#define KIND_STORE       (1u << 1)
+#define KIND_CALL        (1u << 2)
+#define KIND_RETURN      (1u << 3)
+#define KIND_BRANCH      (1u << 4)
+#define KIND_PHI         (1u << 5)
+#define KIND_CMP         (1u << 6)
+#define KIND_BITCAST     (1u << 7)
+#define KIND_GETPTR      (1u << 8)
+#define KIND_ADD         (1u << 9)
+#define KIND_INT_SUB     (1u << 10)
+#define KIND_MUL         (1u << 11)
+#define KIND_CONST       (1u << 12)
+#define KIND_TRANSPARENT (1u << 13)
 
 DFGNode::DFGNode(int t_id, bool t_precisionAware, Value* t_inst, std::string opcodeName,
                  StringRef t_stringRef) {
@@ -19,8 +37,8 @@ DFGNode::DFGNode(int t_id, bool t_precisionAware, Value* t_inst, std::string opc
   m_precisionAware = t_precisionAware;
   m_inst = t_inst;
   m_stringRef = t_stringRef;
-  m_predNodes = NULL;
-  m_succNodes = NULL;
+  m_hasPredNodes = false;
+  m_hasSuccNodes = false;
   m_opcodeName = opcodeName;
   m_isMapped = false;
   m_numConst = 0;
@@ -29,7 +47,6 @@ DFGNode::DFGNode(int t_id, bool t_precisionAware, Value* t_inst, std::string opc
   m_isPatternRoot = false;
   m_patternRoot = NULL;
   m_critical = false;
-  m_cycleID = new list<int>();
   m_level = 0;
   m_execLatency = 1;
   m_pipelinable = false;
@@ -37,6 +54,7 @@ DFGNode::DFGNode(int t_id, bool t_precisionAware, Value* t_inst, std::string opc
   m_predicatees = NULL;
   m_isPredicater = false;
   m_patternNodes = new list<DFGNode*>();
+  initKinds();
   initType();
 }
 
@@ -75,21 +93,31 @@ void DFGNode::setCritical() {
 }
 
 void DFGNode::addCycleID(int t_cycleID) {
-  m_cycleID->push_back(t_cycleID);
+  unsigned word = t_cycleID / 64;
+  if (m_cycleBits.size() <= word)
+    m_cycleBits.resize(word + 1, 0);
+  m_cycleBits[word] |= 1ULL << (t_cycleID % 64);
 }
 
-list<int>* DFGNode::getCycleIDs() {
-  return m_cycleID;
+void DFGNode::clearCycleIDs() {
+  m_cycleBits.clear();
+}
+
+bool DFGNode::isInCycle(int t_cycleID) {
+  unsigned word = t_cycleID / 64;
+  return word < m_cycleBits.size() and
+         ((m_cycleBits[word] >> (t_cycleID % 64)) & 1ULL);
+}
+
+vector<uint64_t>* DFGNode::getCycleBits() {
+  return &m_cycleBits;
 }
 
 bool DFGNode::shareSameCycle(DFGNode* t_node) {
-  // cout<<"[Tan] in shareSameCycle node "<<t_node->getID()<<endl;
-  list<int>* my_list = t_node->getCycleIDs();
-  for (int cycleID: *m_cycleID) {
-    bool found = (find(my_list->begin(), my_list->end(), cycleID) != my_list->end());
-    if (found) {
+  unsigned words = min(m_cycleBits.size(), t_node->m_cycleBits.size());
+  for (unsigned i=0; i<words; ++i) {
+    if (m_cycleBits[i] & t_node->m_cycleBits[i])
       return true;
-    }
   }
   return false;
 }
@@ -151,6 +179,10 @@ Value *DFGNode::getValue() {
 	return m_inst;
 }
 
+bool DFGNode::hasValue() {
+	return m_inst != nullptr;
+}
+
 bool DFGNode::isInst() {
 	if (m_inst == nullptr) {
 		// as above
@@ -165,81 +197,36 @@ StringRef DFGNode::getStringRef() {
 }
 
 bool DFGNode::isCall() {
-  if (m_opcodeName.compare("call") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_CALL;
 }
 
 bool DFGNode::isLoad() {
-  if (m_opcodeName.compare("load") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_LOAD;
 }
 
 bool DFGNode::isConst() {
-	if (m_opcodeName.rfind("const_") == 0)
-		return true;
-	return false;
+	return m_kinds & KIND_CONST;
 }
 
-// Not all nodes actually require any compute resources.
+// Not all nodes actually require any compute resources (see initKinds()).
 bool DFGNode::isTransparentOp() {
-	if (m_opcodeName.compare("sitofp") == 0
-			// These are transparent becuase they are rare/llvm-specific
-			// and not discussed in the architecture-style papers.
-			|| m_opcodeName.compare("fptosi") == 0
-			|| m_opcodeName.compare("ret") == 0
-			|| m_opcodeName.compare("phi") == 0
-			|| m_opcodeName.compare("bitcast") == 0
-			|| m_opcodeName.compare("trunc") == 0
-			|| m_opcodeName.compare("select") == 0
-			|| m_opcodeName.compare("const_fp") == 0
-			|| m_opcodeName.compare("Constant") == 0
-			// These ones are not so much 'transparent'
-			// as "I'm not 100% sure that they
-			// are really different from load/store.  Perhaps
-			// we should just include these with them.
-			// The rewrite rules are not llvm-specific,
-			// so I guess the point is to ignore the llvm-specific
-			// ops because they aren't representative.
-			|| m_opcodeName.compare("getelementptr") == 0
-			|| m_opcodeName.compare("shufflevector") == 0
-			|| m_opcodeName.compare("extractelement") == 0
-			|| m_opcodeName.compare("insertelement") == 0
-			// I don't understand why CGRA-mapper would ever
-			// produce a loop mapping w/out these, but it
-			// does sometimes, so give them a free pass,
-			// as it's compeltely reasonable to require that
-			// ld/st operations exist!
-			|| m_opcodeName.compare("load") == 0
-			|| m_opcodeName.compare("store") == 0
-			)
-		return true;
-	return false;
+	return m_kinds & KIND_TRANSPARENT;
 }
 
 bool DFGNode::isReturn() {
-  if (m_opcodeName.compare("ret") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_RETURN;
 }
 
 bool DFGNode::isStore() {
-  if (m_opcodeName.compare("store") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_STORE;
 }
 
 bool DFGNode::isBranch() {
-  if (m_opcodeName.compare("br") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_BRANCH;
 }
 
 bool DFGNode::isPhi() {
-  if (m_opcodeName.compare("phi") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_PHI;
 }
 
 bool DFGNode::isOpt(string t_opt) {
@@ -249,54 +236,32 @@ bool DFGNode::isOpt(string t_opt) {
 }
 
 bool DFGNode::isMul() {
-  if (m_opcodeName.compare("fmul") == 0 or
-      m_opcodeName.compare("mul") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_MUL;
 }
 
 bool DFGNode::isAdd() {
-  if (m_opcodeName.compare("getelementptr") == 0 or
-      m_opcodeName.compare("add") == 0  or
-      m_opcodeName.compare("fadd") == 0 or
-      m_opcodeName.compare("sub") == 0  or
-      m_opcodeName.compare("fsub") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_ADD;
 }
 
 bool DFGNode::isBr() {
-	if (m_opcodeName.compare("br") == 0) {
-		return true;
-	}
-
-	return false;
+	return m_kinds & KIND_BRANCH;
 }
 
 bool DFGNode::isIntSub() {
 	cout << m_opcodeName << endl;
-	if (m_opcodeName.compare("sub") == 0) // or
-			//m_opcodeName.compare("fsub") == 0)
-		return true;
-	return false;
+	return m_kinds & KIND_INT_SUB;
 }
 
 bool DFGNode::isCmp() {
-  if (m_opcodeName.compare("icmp") == 0 or m_opcodeName.compare("cmp") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_CMP;
 }
 
 bool DFGNode::isBitcast() {
-  if (m_opcodeName.compare("bitcast") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_BITCAST;
 }
 
 bool DFGNode::isGetptr() {
-  if (m_opcodeName.compare("getelementptr") == 0)
-    return true;
-  return false;
+  return m_kinds & KIND_GETPTR;
 }
 
 bool DFGNode::hasCombined() {
@@ -313,6 +278,7 @@ void DFGNode::addPatternPartner(DFGNode* t_patternNode) {
   m_patternNodes->push_back(t_patternNode);
   t_patternNode->setPatternRoot(this);
   m_opcodeName += t_patternNode->getOpcodeName();
+  initKinds();
 }
 
 list<DFGNode*>* DFGNode::getPatternNodes() {
@@ -402,104 +368,111 @@ bool DFGNode::isPipelinable() {
 }
 
 bool DFGNode::shareFU(DFGNode* t_dfgNode) {
-  if (t_dfgNode->getFuType().compare(m_fuType) == 0) {
-    return true;
-  }
-  return false;
-}
-
+  return t_dfgNode->m_fuTypeID == m_fuTypeID;
+}
+
+// The opt type and the functional unit type of each known opcode.
+static const unordered_map<string, pair<string, string>> optTypes = {
+  {"load",           {"OPT_LD",      "MemUnit"}},
+  {"store",          {"OPT_STR",     "MemUnit"}},
+  {"br",             {"OPT_BRH",     "Branch"}},
+  {"phi",            {"OPT_PHI",     "Phi"}},
+  {"icmp",           {"OPT_EQ",      "Comp"}},
+  {"cmp",            {"OPT_EQ",      "Comp"}},
+  {"bitcast",        {"OPT_NAH",     "Alu"}},
+  {"getelementptr",  {"OPT_ADD",     "Alu"}},
+  {"add",            {"OPT_ADD",     "Alu"}},
+  {"sdiv",           {"OPT_DIV",     "Div"}},
+  {"div",            {"OPT_DIV",     "Div"}},
+  {"srem",           {"OPT_REM",     "Div"}},
+  {"rem",            {"OPT_REM",     "Div"}},
+  {"trunc",          {"OPT_TRUNC",   "Alu"}},
+  {"select",         {"OPT_SEL",     "Select"}},
+  {"ext",            {"OPT_EXT",     "ext"}},
+  {"sext",           {"OPT_EXT",     "sext"}},
+  {"zext",           {"OPT_EXT",     "zext"}},
+  {"extractelement", {"OPT_EXTRACT", "extract"}},
+  {"fadd",           {"OPT_ADD",     "Alu"}},
+  {"sub",            {"OPT_SUB",     "Alu"}},
+  {"fsub",           {"OPT_SUB",     "Alu"}},
+  {"xor",            {"OPT_XOR",     "Alu"}},
+  {"or",             {"OPT_OR",      "Logic"}},
+  {"and",            {"OPT_AND",     "Logic"}},
+  {"mul",            {"OPT_MUL",     "Mul"}},
+  {"fmul",           {"OPT_MUL",     "Mul"}},
+  {"shl",            {"OPT_SHL",     "Shift"}},
+  {"lshr",           {"OPT_LSR",     "Shift"}},
+  {"ashr",           {"OPT_ASR",     "Shift"}},
+};
+
+// The FU type is interned as well, so shareFU() compares two IDs.
 void DFGNode::initType() {
-  if (isLoad()) {
-    m_optType = "OPT_LD";
-    m_fuType = "MemUnit";
-  } else if (isStore()) {
-    m_optType = "OPT_STR";
-    m_fuType = "MemUnit";
-  } else if (isBranch()) {
-    m_optType = "OPT_BRH";
-    m_fuType = "Branch";
-  } else if (isPhi()) {
-    m_optType = "OPT_PHI";
-    m_fuType = "Phi";
-  } else if (isCmp()) {
-    m_optType = "OPT_EQ";
-    m_fuType = "Comp";
-  } else if (isBitcast()) {
-    m_optType = "OPT_NAH";
-    m_fuType = "Alu";
-  } else if (isGetptr()) {
-    m_optType += "OPT_ADD";
-    m_fuType = "Alu";
-  } else if (m_opcodeName.compare("add") == 0) {
-    m_optType = "OPT_ADD";
-    m_fuType = "Alu";
-  } else if (m_opcodeName.compare("sdiv") == 0) {
-    m_optType = "OPT_DIV";
-    m_fuType = "Div";
-  } else if (m_opcodeName.compare("div") == 0) {
-    m_optType = "OPT_DIV";
-    m_fuType = "Div";
-  } else if (m_opcodeName.compare("srem") == 0) {
-    m_optType = "OPT_REM";
-    m_fuType = "Div";
-  } else if (m_opcodeName.compare("rem") == 0) {
-    m_optType = "OPT_REM";
-    m_fuType = "Div";
-  } else if (m_opcodeName.compare("trunc") == 0) {
-    m_optType = "OPT_TRUNC";
-    m_fuType = "Alu";
-  } else if (m_opcodeName.compare("select") == 0) {
-    m_optType = "OPT_SEL";
-    m_fuType = "Select";
-  } else if (m_opcodeName.compare("ext") == 0) {
-    m_optType = "OPT_EXT";
-    m_fuType = "ext";
-  } else if (m_opcodeName.compare("sext") == 0) {
-    m_optType = "OPT_EXT";
-    m_fuType = "sext";
-  } else if (m_opcodeName.compare("zext") == 0) {
-    m_optType = "OPT_EXT";
-    m_fuType = "zext";
-  } else if (m_opcodeName.compare("extractelement") == 0) {
-    m_optType = "OPT_EXTRACT";
-    m_fuType = "extract";
-  } else if (m_opcodeName.compare("fadd") == 0) {
-    m_optType = "OPT_ADD";
-    m_fuType = "Alu";
-  } else if (m_opcodeName.compare("sub") == 0) {
-    m_optType = "OPT_SUB";
-    m_fuType = "Alu";
-  } else if (m_opcodeName.compare("fsub") == 0) {
-    m_optType = "OPT_SUB";
-    m_fuType = "Alu";
-  } else if (m_opcodeName.compare("xor") == 0) {
-    m_optType = "OPT_XOR";
-    m_fuType = "Alu";
-  } else if (m_opcodeName.compare("or") == 0) {
-    m_optType = "OPT_OR";
-    m_fuType = "Logic";
-  } else if (m_opcodeName.compare("and") == 0) {
-    m_optType = "OPT_AND";
-    m_fuType = "Logic";
-  } else if (m_opcodeName.compare("mul") == 0) {
-    m_optType = "OPT_MUL";
-    m_fuType = "Mul";
-  } else if (m_opcodeName.compare("fmul") == 0) {
-    m_optType = "OPT_MUL";
-    m_fuType = "Mul";
-  } else if (m_opcodeName.compare("shl") == 0) {
-    m_optType = "OPT_SHL";
-    m_fuType = "Shift";
-  } else if (m_opcodeName.compare("lshr") == 0) {
-    m_optType = "OPT_LSR";
-    m_fuType = "Shift";
-  } else if (m_opcodeName.compare("ashr") == 0) {
-    m_optType = "OPT_ASR";
-    m_fuType = "Shift";
+  auto it = optTypes.find(m_opcodeName);
+  if (it != optTypes.end()) {
+    m_optType = it->second.first;
+    m_fuType = it->second.second;
   } else {
     m_optType = "Unfamiliar: " + m_opcodeName;
     m_fuType = "Unknown";
   }
+  m_fuTypeID = ::getOperationID(m_fuType);
+}
+
+// The opcodes a node can be, and the ones that are treated as transparent
+// (i.e., not requiring compute resources, see CGRANode::canSupport()).
+static const unordered_map<string, unsigned> opcodeKinds = {
+  // The mapper sometimes produces a loop mapping without the ld/st
+  // operations, so they get a free pass as well.
+  {"load",           KIND_LOAD | KIND_TRANSPARENT},
+  {"store",          KIND_STORE | KIND_TRANSPARENT},
+  {"call",           KIND_CALL},
+  {"ret",            KIND_RETURN | KIND_TRANSPARENT},
+  {"br",             KIND_BRANCH},
+  {"phi",            KIND_PHI | KIND_TRANSPARENT},
+  {"icmp",           KIND_CMP},
+  {"cmp",            KIND_CMP},
+  {"bitcast",        KIND_BITCAST | KIND_TRANSPARENT},
+  {"getelementptr",  KIND_GETPTR | KIND_ADD | KIND_TRANSPARENT},
+  {"add",            KIND_ADD},
+  {"fadd",           KIND_ADD},
+  {"sub",            KIND_ADD | KIND_INT_SUB},
+  {"fsub",           KIND_ADD},
+  {"mul",            KIND_MUL},
+  {"fmul",           KIND_MUL},
+  // These are transparent becuase they are rare/llvm-specific
+  // and not discussed in the architecture-style papers.
+  {"sitofp",         KIND_TRANSPARENT},
+  {"fptosi",         KIND_TRANSPARENT},
+  {"trunc",          KIND_TRANSPARENT},
+  {"select",         KIND_TRANSPARENT},
+  {"const_fp",       KIND_TRANSPARENT},
+  {"Constant",       KIND_TRANSPARENT},
+  // These ones are not so much 'transparent' as "I'm not 100% sure that
+  // they are really different from load/store". The rewrite rules are not
+  // llvm-specific, so the llvm-specific ops are ignored because they
+  // aren't representative.
+  {"shufflevector",  KIND_TRANSPARENT},
+  {"extractelement", KIND_TRANSPARENT},
+  {"insertelement",  KIND_TRANSPARENT},
+};
+
+// Caches the opcode ID and the kinds of the node, which need to be redone
+// whenever the opcode name changes (e.g., the node is fused with its
+// pattern partners).
+void DFGNode::initKinds() {
+  m_operationID = ::getOperationID(m_opcodeName);
+  m_kinds = 0;
+  auto it = opcodeKinds.find(m_opcodeName);
+  if (it != opcodeKinds.end()) {
+    m_kinds = it->second;
+  }
+  if (m_opcodeName.rfind("const_") == 0) {
+    m_kinds |= KIND_CONST;
+  }
+}
+
+OperationID DFGNode::getOperationID() {
+  return m_operationID;
 }
 
 list<DFGEdge*> *DFGNode::getInEdges() {
@@ -511,43 +484,35 @@ list<DFGEdge*> *DFGNode::getOutEdges() {
 }
 
 list<DFGNode*>* DFGNode::getPredNodes() {
-  if (m_predNodes != NULL)
-    return m_predNodes;
+  if (m_hasPredNodes)
+    return &m_predNodes;
 
-  m_predNodes = new list<DFGNode*>();
+  m_predNodes.clear();
   for (DFGEdge* edge: m_inEdges) {
     assert(edge->getDst() == this);
-    m_predNodes->push_back(edge->getSrc());
+    m_predNodes.push_back(edge->getSrc());
   }
   if (isBranch()) {
-    list<DFGNode*>* m_tempNodes = new list<DFGNode*>();
-    for (DFGNode* node: *m_predNodes) {
-      // make sure the CMP node is the last one in the predecessors,
-      // so the JSON file will get the correct ordering.
-      if (!node->isCmp()) {
-        m_tempNodes->push_back(node);
-      }
-    }
-    for (DFGNode* node: *m_predNodes) {
-      if (node->isCmp()) {
-        m_tempNodes->push_back(node);
-      }
-    }
-    m_predNodes = m_tempNodes;
+    // make sure the CMP node is the last one in the predecessors,
+    // so the JSON file will get the correct ordering.
+    stable_partition(m_predNodes.begin(), m_predNodes.end(),
+                     [](DFGNode* node) { return !node->isCmp(); });
   }
-  return m_predNodes;
+  m_hasPredNodes = true;
+  return &m_predNodes;
 }
 
 list<DFGNode*>* DFGNode::getSuccNodes() {
-  if (m_succNodes != NULL)
-    return m_succNodes;
+  if (m_hasSuccNodes)
+    return &m_succNodes;
 
-  m_succNodes = new list<DFGNode*>();
+  m_succNodes.clear();
   for (DFGEdge* edge: m_outEdges) {
     assert(edge->getSrc() == this);
-    m_succNodes->push_back(edge->getDst());
+    m_succNodes.push_back(edge->getDst());
   }
-  return m_succNodes;
+  m_hasSuccNodes = true;
+  return &m_succNodes;
 }
 
 void DFGNode::setInEdge(DFGEdge* t_dfgEdge) {
@@ -566,12 +531,7 @@ void DFGNode::cutEdges() {
   m_inEdges.clear();
   m_outEdges.clear();
 
-  if (m_predNodes != NULL) {
-    m_predNodes = NULL;
-  }
-  if (m_succNodes != NULL) {
-    m_succNodes = NULL;
-  }
+  clearCachedNodes();
 }
 
 DFGEdge *DFGNode::getPredEdge(int index) {
@@ -643,6 +603,6 @@ OperationNumber DFGNode::getOperation() {
 }
 
 void DFGNode::clearCachedNodes() {
-	m_predNodes = NULL;
-	m_succNodes = NULL;
+	m_hasPredNodes = false;
+	m_hasSuccNodes = false;
 }
@@ -20,6 +20,9 @@
 #include <list>
 #include <stdio.h>
 #include <iostream>
+#include <atomic>
+#include <vector>
+#include <stdint.h>
 
 #include "DFGEdge.h"
 #include "OperationMap.h"
@@ -41,14 +44,26 @@ class DFGNode {
     string m_opcodeName;
     list<DFGEdge*> m_inEdges;
     list<DFGEdge*> m_outEdges;
-    list<DFGNode*>* m_succNodes;
-    list<DFGNode*>* m_predNodes;
+    // The neighbours are derived from the edges on demand and kept until
+    // the edges change.
+    list<DFGNode*> m_succNodes;
+    list<DFGNode*> m_predNodes;
+    bool m_hasSuccNodes;
+    bool m_hasPredNodes;
     list<DFGNode*>* m_patternNodes;
-    list<int>* m_cycleID;
-    bool m_isMapped;
+    // Bit i is set if the node is on the i-th cycle of the DFG.
+    vector<uint64_t> m_cycleBits;
+    // Concurrent mappings of the same DFG (see Mapper::heuristicMap()) all
+    // update the flag.
+    atomic<bool> m_isMapped;
     int m_numConst;
     string m_optType;
     string m_fuType;
+    // Cached from the opcode name by initKinds() and initType().
+    OperationID m_operationID;
+    OperationID m_fuTypeID;
+    unsigned m_kinds;
+    void initKinds();
     bool m_combined;
     bool m_isPatternRoot;
     bool m_critical;
@@ -96,6 +111,7 @@ class DFGNode {
     void addPatternPartner(DFGNode*);
     Instruction* getInst(); // only works if this is actually an instruction (see isInst())
 	Value *getValue();
+	bool hasValue(); // false for the nodes loaded from a json file
     StringRef getStringRef();
     string getOpcodeName();
     list<DFGNode*>* getPredNodes();
@@ -125,9 +141,11 @@ class DFGNode {
     list<DFGNode*>* getPatternNodes();
     void setCritical();
     void addCycleID(int);
+    void clearCycleIDs();
+    bool isInCycle(int);
+    vector<uint64_t>* getCycleBits();
     bool isCritical();
     int getCycleID();
-    list<int>* getCycleIDs();
     void addPredicatee(DFGNode*);
     list<DFGNode*>* getPredicatees();
     void setPredicatee();
@@ -141,6 +159,7 @@ class DFGNode {
     bool isPipelinable();
     bool shareFU(DFGNode*);
 	OperationNumber getOperation();
+    OperationID getOperationID();
 };
 
 #endif
@@ -2,11 +2,120 @@
 #include "DFG.h"
 #include "Options.h"
 #include "Mapper.h"
+#include "MappingContext.h"
 #include "RustConversion.h"
 #include "Rewriter.h"
 #include "MapResult.h"
+#include <atomic>
+#include <climits>
+#include <thread>
+#include <vector>
+
+// Maps the rewritten DFGs concurrently, each in a clone of the context.
+// The serial doMap() keeps the first DFG with the smallest II, so the
+// incumbent is ranked by (II, DFG number). A DFG is skipped once its
+// ResMII/RecMII lower bound can not beat the incumbent anymore. The
+// winning DFG is mapped again in 'context' for the reports.
+MapResult *doConcurrentMap(MappingContext *context, list<DFG *> *generated_dfgs, int II) {
+    Options *options = context->getOptions();
+    CGRA *cgra = context->getCGRA();
+    Mapper *mapper = context->getMapper();
+    vector<DFG *> dfgs(generated_dfgs->begin(), generated_dfgs->end());
+    int dfgCount = dfgs.size();
+    vector<int> lowerBounds(dfgCount);
+    for (int i = 0; i < dfgCount; i++) {
+        DFG *dfg = dfgs[i];
+        if (options->DebugMappingLoop)
+        {
+            cout << "Starting mapper for new DFG (Number " << i + 1 << ")" << endl;
+            cout << "DFG is : " << dfg->asString() << endl;
+        }
+        dfg->rejoinCycles();
+        if (options->DebugMappingLoop) {
+          cout << "Opcode distribtuion after rejoining cycles is \n";
+          dfg->showOpcodeDistribution();
+        }
+        int ResMII = mapper->getResMII(dfg, cgra);
+        // -1 marks a DFG that can not be mapped at any II.
+        lowerBounds[i] = ResMII == -1 ? -1 : max(II, max(ResMII, mapper->getRecMII(dfg)));
+    }
+
+    // The II value of each worker is tried serially, the concurrency is
+    // across the DFGs.
+    int threadCount = min(options->MapThreads, dfgCount);
+    vector<MappingContext *> variantContexts;
+    for (int i = 0; i < threadCount; i++) {
+        variantContexts.push_back(context->clone());
+        variantContexts[i]->getOptions()->MapThreads = 1;
+    }
+
+    atomic<int> nextDFG(0);
+    atomic<long> bestRank(LONG_MAX);
+    vector<MapResult *> results(dfgCount, nullptr);
+    vector<thread> workers;
+    for (int i = 0; i < threadCount; i++) {
+        workers.push_back(thread([&, i]() {
+            MappingContext *variantContext = variantContexts[i];
+            while (true) {
+                int index = nextDFG++;
+                if (index >= dfgCount)
+                    break;
+                if (lowerBounds[index] == -1 || long(lowerBounds[index]) * dfgCount + index > bestRank)
+                    continue;
+                MapResult *res = variantContext->getMapper()->heuristicMap(variantContext->getParameters(), variantContext->getOptions(), variantContext->getCGRA(), dfgs[index], II);
+                results[index] = res;
+                if (res->failed())
+                    continue;
+                long rank = long(res->II()) * dfgCount + index;
+                long best = bestRank;
+                while (rank < best && !bestRank.compare_exchange_weak(best, rank));
+            }
+        }));
+    }
+    for (thread &worker : workers)
+        worker.join();
+    for (MappingContext *variantContext : variantContexts)
+        delete variantContext;
+
+    MapResult *winning_res = new MapResult(true, -1, -1, nullptr);
+    for (int i = 0; i < dfgCount; i++) {
+        MapResult *res = results[i];
+        if (res == nullptr) {
+            if (lowerBounds[i] == -1)
+                cout << "DFG Number " << i + 1 << " can not be mapped at any II" << endl;
+            else
+                cout << "DFG Number " << i + 1 << " skipped with lower bound " << lowerBounds[i] << endl;
+            continue;
+        }
+        if ((winning_res->failed() || (res->II() < winning_res->II())) && !res->failed())
+        {
+            delete winning_res;
+            winning_res = res;
+        }
+        cout << "DFG Number " << i + 1 << " had II " << res->II() << " fail? " << res->failed() << endl;
+    }
+
+    if (!winning_res->failed()) {
+        Options serialOptions = *options;
+        serialOptions.MapThreads = 1;
+        // The re-map starts cold (no warm start from the lower IIs), so it can
+        // settle on a higher II or fail: its result is the one that describes
+        // the schedule on 'cgra'.
+        MapResult *remapped = mapper->heuristicMap(context->getParameters(), &serialOptions, cgra, winning_res->winningDFG(), winning_res->II());
+        delete winning_res;
+        winning_res = remapped;
+    }
+    return winning_res;
+}
+
+MapResult *doMap(MappingContext *context, list<DFG *> *generated_dfgs, int II) {
+    Options *options = context->getOptions();
+    Parameters *params = context->getParameters();
+    CGRA *cgra = context->getCGRA();
+    Mapper *mapper = context->getMapper();
+    if (options->MapThreads > 1 && generated_dfgs->size() > 1)
+        return doConcurrentMap(context, generated_dfgs, II);
 
-MapResult *doMap(Options *options, Parameters *params, CGRA *cgra, Mapper *mapper, list<DFG *> *generated_dfgs, int II) {
     MapResult *winning_res = new MapResult(true, -1, -1, nullptr);
     int dfg_no = 0;
     for (DFG *dfg : *generated_dfgs)
@@ -26,6 +135,13 @@ MapResult *doMap(Options *options, Parameters *params, CGRA *cgra, Mapper *mappe
           dfg->showOpcodeDistribution();
         }
 
+        // Don't sweep the II values for a DFG that can not be mapped at all.
+        if (mapper->getResMII(dfg, cgra) == -1)
+        {
+            cout << "DFG Number " << dfg_no << " can not be mapped at any II" << endl;
+            continue;
+        }
+
         MapResult *res = mapper->heuristicMap(params, options, cgra, dfg, II);
 
         if ((winning_res->failed() || (res->II() < winning_res->II())) && !res->failed())
@@ -47,8 +163,11 @@ MapResult *doMap(Options *options, Parameters *params, CGRA *cgra, Mapper *mappe
 
 // This doesn't return anything, because it prints it out to stdout.
 // But it would probably be more useful if it did.
-void runMapping(CGRA *cgra, DFG *dfg, Parameters *params, Options *options) {
-    Mapper *mapper = new Mapper();
+void runMapping(MappingContext *context, DFG *dfg) {
+    Options *options = context->getOptions();
+    Parameters *params = context->getParameters();
+    CGRA *cgra = context->getCGRA();
+    Mapper *mapper = context->getMapper();
 
     // Show the count of different opcodes (IRs).
     errs() << "==================================\n";
@@ -70,6 +189,10 @@ void runMapping(CGRA *cgra, DFG *dfg, Parameters *params, Options *options) {
     int II = ResMII;
     if (II < RecMII)
         II = RecMII;
+    // The DFG can not be mapped as is (ResMII -1), but the rewritten DFGs
+    // might be, each of them is checked again in doMap().
+    if (II < 1)
+        II = 1;
 
     if (!params->doCGRAMapping)
     {
@@ -95,13 +218,13 @@ void runMapping(CGRA *cgra, DFG *dfg, Parameters *params, Options *options) {
         cout << "Using Greedy Only Mode\n";
         generated_dfgs = rewrite_with_graphs(options, cgra, dfg);
 
-        mapResult = doMap(options, params, cgra, mapper, generated_dfgs, II);
+        mapResult = doMap(context, generated_dfgs, II);
     }
     else if (options->UseEGraphs)
     {
         cout << "Using EGraphs Only Mode\n";
         generated_dfgs = rewrite_with_egraphs(options, cgra, dfg);
-        mapResult = doMap(options, params, cgra, mapper, generated_dfgs, II);
+        mapResult = doMap(context, generated_dfgs, II);
     }
     else if (options->UseRewriter)
     {
@@ -110,13 +233,13 @@ void runMapping(CGRA *cgra, DFG *dfg, Parameters *params, Options *options) {
         DFG copied_dfg(*dfg); // need to copy before this changes the DFG.
         // Try the normal rewriter first.
         generated_dfgs = rewrite_with_graphs(options, cgra, dfg);
-        mapResult = doMap(options, params, cgra, mapper, generated_dfgs, II);
+        mapResult = doMap(context, generated_dfgs, II);
 
         if (mapResult->failed()) {
             cout << "Falling back to EGraphs\n";
             // try again with egraphs.
             generated_dfgs = rewrite_with_egraphs(options, cgra, &copied_dfg);
-            mapResult = doMap(options, params, cgra, mapper, generated_dfgs, II);
+            mapResult = doMap(context, generated_dfgs, II);
         } else {
             errs() << "Initial Greedy Pass Succeeded\n";
             // errs() << "==================================\n";
@@ -132,12 +255,12 @@ void runMapping(CGRA *cgra, DFG *dfg, Parameters *params, Options *options) {
         // call the copy constructor
         DFG copied_dfg(*dfg); // need to copy before this changes the DFG.
         generated_dfgs = rewrite_with_mcts(options, cgra, dfg);
-        mapResult = doMap(options, params, cgra, mapper, generated_dfgs, II);
+        mapResult = doMap(context, generated_dfgs, II);
         // NOTE: the cost model is wrong; i.e. even if rmcts gets a acceptable IRs
         // the mapping still fail! So fall back to egraph
         if (mapResult->failed()) {
             generated_dfgs = rewrite_with_egraphs(options, cgra, &copied_dfg);
-            mapResult = doMap(options, params, cgra, mapper, generated_dfgs, II);
+            mapResult = doMap(context, generated_dfgs, II);
         } else {
           errs() << "Initial RMCTS Pass Succeeded\n";
           // errs() << "==================================\n";
@@ -152,7 +275,7 @@ void runMapping(CGRA *cgra, DFG *dfg, Parameters *params, Options *options) {
         // a singleton list.
         generated_dfgs = new list<DFG *>;
         generated_dfgs->push_back(dfg);
-        mapResult = doMap(options, params, cgra, mapper, generated_dfgs, II);
+        mapResult = doMap(context, generated_dfgs, II);
     }
 
     // Create a failed mapping result as default.
@@ -174,7 +297,7 @@ void runMapping(CGRA *cgra, DFG *dfg, Parameters *params, Options *options) {
                 cout << "[Mapping:success]\n";
             }
             cout << "II: " << mapResult->II() << "\n";
-            mapper->generateJSON(cgra, mapResult->winningDFG(), mapResult, params->isStaticElasticCGRA);
+            mapper->generateJSON(cgra, mapResult, params->isStaticElasticCGRA);
             cout << "[Output Json]\n";
         // }
     }
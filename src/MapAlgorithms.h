@@ -4,8 +4,9 @@
 #include "CGRA.h"
 #include "Options.h"
 #include "DFG.h"
+#include "MappingContext.h"
 #include <iostream>
 #include <sstream>
 
-void runMapping(CGRA *cgra, DFG *dfg, Parameters *params, Options *options);
+void runMapping(MappingContext *context, DFG *dfg);
 #endif
\ No newline at end of file
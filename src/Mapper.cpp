@@ -15,8 +15,13 @@
 #include <list>
 #include <map>
 #include <fstream>
+#include <thread>
+#include <algorithm>
+#include <vector>
+#include <random>
 #include "json.hpp"
 #include "Options.h"
+#include "DFGLevels.h"
 
 // todo --- what should this be?
 #define MAX_II_DEPTH 50
@@ -24,35 +29,218 @@
 //#include <nlohmann/json.hpp>
 //using json = nlohmann::json;
 
+// Whether the demand of every class of DFG nodes can be served by the
+// tiles supporting the class without exceeding the capacity of any tile,
+// i.e., whether the maximum flow of the network source -> class -> tile
+// -> sink saturates all the demands.
+static bool canDistribute(map<vector<bool>, int>* t_demands,
+                          vector<int>* t_capacities) {
+  int classCount = t_demands->size();
+  int tileCount = t_capacities->size();
+  int source = 0;
+  int sink = classCount + tileCount + 1;
+  int vertexCount = sink + 1;
+  vector<vector<int>> residual(vertexCount, vector<int>(vertexCount, 0));
+  int totalDemand = 0;
+  int c = 1;
+  for (map<vector<bool>, int>::iterator iter=t_demands->begin();
+      iter!=t_demands->end(); ++iter, ++c) {
+    residual[source][c] = iter->second;
+    totalDemand += iter->second;
+    // A class never sends more than its demand to a tile.
+    for (int t=0; t<tileCount; ++t) {
+      if (iter->first[t])
+        residual[c][classCount + 1 + t] = iter->second;
+    }
+  }
+  for (int t=0; t<tileCount; ++t)
+    residual[classCount + 1 + t][sink] = (*t_capacities)[t];
+
+  int flow = 0;
+  vector<int> previous(vertexCount);
+  while (flow < totalDemand) {
+    fill(previous.begin(), previous.end(), -1);
+    previous[source] = source;
+    list<int> queue;
+    queue.push_back(source);
+    while (!queue.empty() and previous[sink] == -1) {
+      int u = queue.front();
+      queue.pop_front();
+      for (int v=0; v<vertexCount; ++v) {
+        if (previous[v] == -1 and residual[u][v] > 0) {
+          previous[v] = u;
+          queue.push_back(v);
+        }
+      }
+    }
+    if (previous[sink] == -1)
+      return false;
+    int bottleneck = totalDemand - flow;
+    for (int v=sink; v!=source; v=previous[v])
+      bottleneck = min(bottleneck, residual[previous[v]][v]);
+    for (int v=sink; v!=source; v=previous[v]) {
+      residual[previous[v]][v] -= bottleneck;
+      residual[v][previous[v]] += bottleneck;
+    }
+    flow += bottleneck;
+  }
+  return true;
+}
+
+// The ResMII is the smallest II at which the DFG nodes can be distributed
+// onto the tiles that support them (CGRANode::canSupport()). Every DFG
+// node starts in its own slot of a tile, and the non-pipelined multi-cycle
+// DFG nodes of the same FU type and latency can not overlap on a tile
+// either. Returns -1 if the DFG can not be mapped at any II, i.e., a DFG
+// node is not supported by any tile or the control memory of the tiles is
+// not enough for the DFG nodes.
 int Mapper::getResMII(DFG* t_dfg, CGRA* t_cgra) {
-  int ResMII = ceil(float(t_dfg->getNodeCount()) / t_cgra->getFUCount());
-  return ResMII;
+  int tileCount = t_cgra->getFUCount();
+  // The DFG nodes supported by the same tiles form a class.
+  map<vector<bool>, int> nodeClasses;
+  map<pair<string, int>, map<vector<bool>, int>> serialClasses;
+  for (DFGNode* dfgNode: t_dfg->nodes) {
+    vector<bool> tiles(tileCount, false);
+    bool isSupported = false;
+    for (int t=0; t<tileCount; ++t) {
+      tiles[t] = t_cgra->getNode(t)->canSupport(dfgNode);
+      isSupported = isSupported or tiles[t];
+    }
+    if (!isSupported) {
+      cout<<"DFG node "<<dfgNode->getID()<<" ("<<dfgNode->getOperation()
+          <<") is not supported by any CGRA node\n";
+      return -1;
+    }
+    ++nodeClasses[tiles];
+    if (dfgNode->isMultiCycleExec() and !dfgNode->isPipelinable()) {
+      ++serialClasses[make_pair(dfgNode->getFuType(),
+                                dfgNode->getExecLatency())][tiles];
+    }
+  }
+
+  vector<int> capacities(tileCount);
+  for (int t=0; t<tileCount; ++t)
+    capacities[t] = t_cgra->getNode(t)->getCtrlMemSize();
+  if (!canDistribute(&nodeClasses, &capacities)) {
+    cout<<"The control memory of the CGRA nodes can not hold the DFG\n";
+    return -1;
+  }
+
+  int ResMII = ceil(float(t_dfg->getNodeCount()) / tileCount);
+  if (ResMII < 1)
+    ResMII = 1;
+  while (1) {
+    fill(capacities.begin(), capacities.end(), ResMII);
+    bool fits = canDistribute(&nodeClasses, &capacities);
+    // A non-pipelined DFG node holds its FU for its latency (at most for
+    // all the II slots).
+    for (map<pair<string, int>, map<vector<bool>, int>>::iterator
+        iter=serialClasses.begin(); fits and iter!=serialClasses.end();
+        ++iter) {
+      int latency = min(iter->first.second, ResMII);
+      map<vector<bool>, int> demands = iter->second;
+      for (map<vector<bool>, int>::iterator demand=demands.begin();
+          demand!=demands.end(); ++demand)
+        demand->second *= latency;
+      fits = canDistribute(&demands, &capacities);
+    }
+    if (fits)
+      return ResMII;
+    ++ResMII;
+  }
+}
+
+// Whether every cycle of the DFG fits in 't_II', i.e., whether the sum of
+// the latencies along any cycle is at most 't_II' times its iteration
+// distance. There is a violating cycle iff the longest paths with the
+// weights 'latency(src) - II * distance' keep growing after as many
+// relaxation rounds as there are nodes (Bellman-Ford). 't_distances' holds
+// the distance of each successor entry of 't_adjacency'.
+static bool fitsRecurrences(DFGAdjacency* t_adjacency,
+    vector<int>* t_latencies, vector<int>* t_distances, int t_II) {
+  int nodeCount = t_adjacency->getNodeCount();
+  vector<long> longest(nodeCount, 0);
+  for (int round=0; round<=nodeCount; ++round) {
+    bool relaxed = false;
+    for (int u=0; u<nodeCount; ++u) {
+      for (int i=t_adjacency->getSuccBegin(u);
+           i<t_adjacency->getSuccEnd(u); ++i) {
+        int v = t_adjacency->getSucc(i);
+        long length = longest[u] + (*t_latencies)[u] -
+            long(t_II) * (*t_distances)[i];
+        if (length > longest[v]) {
+          longest[v] = length;
+          relaxed = true;
+        }
+      }
+    }
+    if (!relaxed)
+      return true;
+  }
+  return false;
 }
 
+// The RecMII is the maximum ratio of the latency to the iteration distance
+// over the DFG cycles (rounded up), found as the smallest II that fits all
+// the recurrences. A cycle without any loop-carried edge is taken as one
+// iteration: its back edge (as DFGLevels finds it) counts as distance 1.
 int Mapper::getRecMII(DFG* t_dfg) {
-  float RecMII = 0.0;
-  float temp_RecMII = 0.0;
-  list<list<DFGNode*>*>* cycles = t_dfg->getCycleLists();//calculateCycles();
-  // errs()<<"... number of cycles: "<<cycles->size()<<" ...\n";
-  // TODO: RecMII = MAX (delay(c) / distance(c))
-  for( list<DFGNode*>* cycle: *cycles) {
-    temp_RecMII = float(cycle->size()) / 1.0;
-    if(temp_RecMII > RecMII)
-      RecMII = temp_RecMII;
+  DFGLevels levels(&t_dfg->nodes);
+  DFGAdjacency* adjacency = levels.getAdjacency();
+  vector<int> latencies;
+  vector<int> distances(adjacency->getEdgeCount());
+  int totalLatency = 0;
+  for (int u=0; u<adjacency->getNodeCount(); ++u) {
+    latencies.push_back(adjacency->getNode(u)->getExecLatency());
+    totalLatency += latencies.back();
+    for (int i=adjacency->getSuccBegin(u); i<adjacency->getSuccEnd(u); ++i) {
+      distances[i] = adjacency->getSuccEdge(i)->getIterationDistance();
+      if (distances[i] == 0 and levels.isBackEdge(i))
+        distances[i] = 1;
+    }
+  }
+
+  int low = 0;
+  int high = totalLatency;
+  while (low < high) {
+    int II = (low + high) / 2;
+    if (fitsRecurrences(adjacency, &latencies, &distances, II))
+      high = II;
+    else
+      low = II + 1;
   }
-  return ceil(RecMII);
+  return low;
 }
 
 void Mapper::constructMRRG(DFG* t_dfg, CGRA* t_cgra, int t_II) {
+  clearRoutingTrees();
+  m_trail.clear();
   m_mapping.clear();
   m_mappingTiming.clear();
+  m_failedDFGNode = NULL;
+  m_tileNodes.assign(t_cgra->getFUCount(), list<DFGNode*>());
+  m_recurrences.reset(t_dfg, t_II);
   t_cgra->constructMRRG(t_II);
   m_maxMappingCycle = t_cgra->getFUCount()*t_II*t_II;
+  if (m_router == NULL or m_router->getCGRA() != t_cgra) {
+    delete m_router;
+    m_router = new Router(t_cgra);
+  }
+  m_router->setCongestionLog(m_rerouting ? &m_congestion : NULL);
+  m_router->setMulticast(m_multicast);
   for (DFGNode* dfgNode: t_dfg->nodes) {
     dfgNode->clearMapped();
   }
 }
 
+// The reports can be asked for before any MRRG is built (e.g., when all the
+// II values failed on the concurrent mappers), there is no node then.
+list<DFGNode*>* Mapper::getMappedDFGNodes(CGRANode* t_cgraNode) {
+  if (t_cgraNode->getID() >= (int)m_tileNodes.size())
+    m_tileNodes.resize(t_cgraNode->getID() + 1);
+  return &m_tileNodes[t_cgraNode->getID()];
+}
+
 // Given that we have already scheduled something, get the max cycle.
 int Mapper::getMaxCycle() {
 	int maxCycleSoFar = 0;
@@ -65,406 +253,304 @@ int Mapper::getMaxCycle() {
 	return maxCycleSoFar;
 }
 
-// The arriving data can stay inside the input buffer
-map<CGRANode*, int>* Mapper::dijkstra_search(CGRA* t_cgra, DFG* t_dfg,
-    int t_II, DFGNode* t_srcDFGNode, DFGNode* t_targetDFGNode,
-    CGRANode* t_dstCGRANode) {
-  list<CGRANode*> searchPool;
-  map<CGRANode*, int> distance;
-  map<CGRANode*, int> timing;
-  map<CGRANode*, CGRANode*> previous;
-//  if (t_srcDFGNode->getID() == 0) {
-//    errs()<<"DEBUG -1, srcDFGNode: "<<(t_srcDFGNode->getID())<<"; CGRANode: "<<m_mapping[t_srcDFGNode]->getID()<<"\n";
-//    errs()<<"DEBUG -2, t_dstCGRANode: "<<t_dstCGRANode->getID()<<"; timing for src: "<<m_mappingTiming[t_srcDFGNode]<<"\n";
-//  }
-  CGRANode* srcCGRANode = m_mapping[t_srcDFGNode];
-  timing[srcCGRANode] = m_mappingTiming[t_srcDFGNode];
-  for (int i=0; i<t_cgra->getRows(); ++i) {
-    for (int j=0; j<t_cgra->getColumns(); ++j) {
-      CGRANode* node = t_cgra->nodes[i][j];
-      distance[node] = m_maxMappingCycle;
-      timing[node] = m_mappingTiming[t_srcDFGNode];
-      timing[node] += t_srcDFGNode->getExecLatency() - 1;
-//      if (t_srcDFGNode->isLoad() or t_srcDFGNode->isStore()) {
-//        timing[node] += 1;
-//      }
-      // TODO: should also consider the xbar here?
-//      if (!cgra->nodes[i][j]->canOccupyFU(timing[node], II)) {
-//        int temp_cycle = timing[node];
-//        timing[node] = m_maxMappingCycle;
-//        while (temp_cycle < m_maxMappingCycle) {
-//          if (cgra->nodes[i][j]->canOccupyFU(temp_cycle, II)) {
-//            timing[node] = temp_cycle;
-//            break;
-//          }
-//          ++temp_cycle;
-//        }
-//      }
-      previous[node] = NULL;
-      searchPool.push_back(t_cgra->nodes[i][j]);
-    }
-  }
-  distance[m_mapping[t_srcDFGNode]] = 0;
-  while (searchPool.size() != 0) {
-    int minCost = m_maxMappingCycle + 1;
-    CGRANode* minNode;
-    for (CGRANode* currentNode: searchPool) {
-      if (distance[currentNode] < minCost) {
-        minCost = distance[currentNode];
-        minNode = currentNode;
-      }
-    }
-    assert(minNode != NULL);
-    searchPool.remove(minNode);
-    // found the target point in the shortest path
-    if (minNode == t_dstCGRANode) {
-      timing[t_dstCGRANode] = minNode->getMinIdleCycle(t_targetDFGNode, timing[minNode], t_II);
-      break;
-    }
-    list<CGRANode*>* currentNeighbors = minNode->getNeighbors();
-//    errs()<<"DEBUG no need?\n";
-
-    for (CGRANode* neighbor: *currentNeighbors) {
-      int cycle = timing[minNode];
-      while (1) {
-        CGRALink* currentLink = minNode->getOutLink(neighbor);
-        // TODO: should also consider the cost of the register file
-        if (currentLink->canOccupy(t_srcDFGNode, srcCGRANode, cycle, t_II)) {
-          // rough estimate the cost based on the suspend cycle
-          int cost = distance[minNode] + (cycle - timing[minNode]) + 1;
-          if (cost < distance[neighbor]) {
-            distance[neighbor] = cost;
-            timing[neighbor] = cycle + 1;
-            previous[neighbor] = minNode;
-          }
-          break;
-        }
-        ++cycle;
-        if(cycle > m_maxMappingCycle)
-          break;
-      }
-    }
-  }
+// The search from a mapped DFG node towards the other tiles does not depend
+// on the target tile, so a single one-to-all search is shared by all the
+// candidate tiles that are evaluated against the same MRRG. Stopping the
+// search at the target would settle the same path, as the tiles on it are
+// settled before the target. The trees are dropped once the MRRG changes.
+Router* Mapper::getRoutingTree(CGRA* t_cgra, int t_II,
+    DFGNode* t_srcDFGNode) {
+  map<DFGNode*, Router*>::iterator iter = m_routingTrees.find(t_srcDFGNode);
+  if (iter != m_routingTrees.end())
+    return iter->second;
+  Router* router = new Router(t_cgra);
+  if (m_rerouting)
+    router->setCongestionLog(&m_congestion);
+  router->setMulticast(m_multicast);
+  int startCycle = m_mappingTiming[t_srcDFGNode] +
+      t_srcDFGNode->getExecLatency() - 1;
+  router->search(t_srcDFGNode, m_mapping[t_srcDFGNode], startCycle, t_II,
+      m_maxMappingCycle, NULL);
+  m_routingTrees[t_srcDFGNode] = router;
+  return router;
+}
 
-  // Get the shortest path.
-  map<CGRANode*, int>* path = new map<CGRANode*, int>();
-  CGRANode* u = t_dstCGRANode;
-  if (previous[u] != NULL or u == m_mapping[t_srcDFGNode]) {
-    while (u != NULL) {
-      (*path)[u] = timing[u];
-      u = previous[u];
-    }
+void Mapper::clearRoutingTrees() {
+  for (map<DFGNode*, Router*>::iterator iter=m_routingTrees.begin();
+      iter!=m_routingTrees.end(); ++iter) {
+    delete iter->second;
   }
-  if (timing[t_dstCGRANode] > m_maxMappingCycle or
-      !t_dstCGRANode->canOccupy(t_targetDFGNode,
-      timing[t_dstCGRANode], t_II)) {
-//    path.clear();
-    delete path;
-    return NULL;
-  }
-  return path;
+  m_routingTrees.clear();
 }
 
-list<map<CGRANode*, int>*>* Mapper::getOrderedPotentialPaths(CGRA* t_cgra,
-    DFG* t_dfg, int t_II, DFGNode* t_dfgNode, list<map<CGRANode*, int>*>* t_paths) {
-  map<map<CGRANode*, int>*, float>* pathsWithCost =
-      new map<map<CGRANode*, int>*, float>();
-  for (list<map<CGRANode*, int>*>::iterator path=t_paths->begin();
-      path!=t_paths->end(); ++path) {
-    if ((*path)->size() == 0)
-      continue;
+Mapper::~Mapper() {
+  clearRoutingTrees();
+  delete m_router;
+}
 
-    map<int, CGRANode*>* reorderPath = getReorderPath(*path);
-//    for (map<CGRANode*, int>::iterator rp=(*path)->begin(); rp!=(*path)->end(); ++rp)
-//      reorderPath[(*rp).second] = (*rp).first;
-//    assert(reorderPath.size() == (*path)->size());
+// The arriving data can stay inside the input buffer. The path is written
+// into 't_path' ordered by cycle, false is returned if the target is not
+// reachable or can not be occupied in time.
+bool Mapper::dijkstra_search(CGRA* t_cgra, int t_II,
+    DFGNode* t_srcDFGNode, DFGNode* t_targetDFGNode,
+    CGRANode* t_dstCGRANode, vector<PathStep>* t_path) {
+  CGRANode* srcCGRANode = m_mapping[t_srcDFGNode];
+  Router* router = getRoutingTree(t_cgra, t_II, t_srcDFGNode);
+  // found the target point in the shortest path
+  int dstTiming = t_dstCGRANode->getMinIdleCycle(t_targetDFGNode,
+      router->getTiming(t_dstCGRANode), t_II);
+  if (dstTiming > m_maxMappingCycle or
+      !t_dstCGRANode->canOccupy(t_targetDFGNode, dstTiming, t_II))
+    return false;
 
-    map<int, CGRANode*>::reverse_iterator riter=reorderPath->rbegin();
+  // Get the shortest path, the timing strictly increases from the source
+  // to the target so the reversed walk is ordered by cycle.
+  CGRANode* u = t_dstCGRANode;
+  if (router->getPrevious(u) == NULL and u != srcCGRANode)
+    return false;
+  t_path->clear();
+  while (u != NULL) {
+    PathStep step = {router->getTiming(u), u};
+    t_path->push_back(step);
+    u = router->getPrevious(u);
+  }
+  reverse(t_path->begin(), t_path->end());
+  t_path->back().cycle = dstTiming;
+  return true;
+}
 
-    int distanceCost = (*riter).first;
-    CGRANode* targetCGRANode = (*riter).second;
-    int targetCycle = (*riter).first;
-    if (distanceCost >= m_maxMappingCycle)
-      continue;
-//    if (t_dfgNode->getID() == 2 or t_dfgNode->getID() == 1) {
-//      errs()<<"DEBUG what?! distance: "<<distanceCost<<"; target CGRA node: "<<targetCGRANode->getID()<<"\n";
-//    }
-    // Consider the cost of the distance.
-    float cost = distanceCost + 1;
-
-    // Consider the same tile mapped with continuously two DFG nodes.
-    map<int, CGRANode*>::iterator lastCGRANodeItr=reorderPath->begin();
-    for (map<int, CGRANode*>::iterator cgraNodeItr=reorderPath->begin();
-        cgraNodeItr!=reorderPath->end(); ++cgraNodeItr) {
-      if (cgraNodeItr != reorderPath->begin()) {
-        int lastCycle = (*lastCGRANodeItr).first;
-        int currentCycle = (*cgraNodeItr).first;
-        int delta = currentCycle - lastCycle;
-        if (delta > 1) {
-          cost = cost + 1.5;
-        }
-      }
-      lastCGRANodeItr = cgraNodeItr;
+float Mapper::getPathCost(CGRA* t_cgra, int t_II,
+    DFGNode* t_dfgNode, PathStep* t_path, int t_length) {
+  PathStep* target = &t_path[t_length - 1];
+  int distanceCost = target->cycle;
+  CGRANode* targetCGRANode = target->tile;
+  int targetCycle = target->cycle;
+  // Consider the cost of the distance.
+  float cost = distanceCost + 1;
+
+  // Consider the same tile mapped with continuously two DFG nodes.
+  for (int i=1; i<t_length; ++i) {
+    int delta = t_path[i].cycle - t_path[i-1].cycle;
+    if (delta > 1) {
+      cost = cost + 1.5;
     }
+  }
 
-    // Consider the single tile that processes everything. FIXME: this is
-    // actually a bug because we use map<CGRANode*, int> rather than
-    // map<int, CGRANode*>, in which case the different cycles's execution
-    // will be wrongly merged into one.
-    if (reorderPath->size() == 1) {
-      cost += 2;
-    }
+  // Consider the single tile that processes everything.
+  if (t_length == 1) {
+    cost += 2;
+  }
 
-    // Consider the cost of the utilization of contrl memory.
-    cost += targetCGRANode->getCurrentCtrlMemItems()/2;
+  // Consider the cost of the utilization of contrl memory.
+  cost += targetCGRANode->getCurrentCtrlMemItems()/2;
 
-    // Consider the cost of the outgoing ports.
-    if (t_dfgNode->getSuccNodes()->size() > 1) {
-      cost += 4 - targetCGRANode->getOutLinks()->size() +
-          abs(t_cgra->getColumns()/2-targetCGRANode->getX()) +
-          abs(t_cgra->getRows()/2-targetCGRANode->getX());
-    }
-    if (t_dfgNode->getPredNodes()->size() > 0) {
-      list<DFGNode*>* tempPredNodes = t_dfgNode->getPredNodes();
-      for (DFGNode* predDFGNode: *tempPredNodes) {
-        if (predDFGNode->getSuccNodes()->size() > 2
-            and m_mapping.find(predDFGNode) != m_mapping.end()) {
-          if (m_mapping[predDFGNode] == targetCGRANode)
-            cost -= 0.5;
-        }
+  // Consider the cost of the outgoing ports.
+  if (t_dfgNode->getSuccNodes()->size() > 1) {
+    cost += 4 - targetCGRANode->getOutLinks()->size() +
+        abs(t_cgra->getColumns()/2-targetCGRANode->getX()) +
+        abs(t_cgra->getRows()/2-targetCGRANode->getX());
+  }
+  if (t_dfgNode->getPredNodes()->size() > 0) {
+    list<DFGNode*>* tempPredNodes = t_dfgNode->getPredNodes();
+    for (DFGNode* predDFGNode: *tempPredNodes) {
+      if (predDFGNode->getSuccNodes()->size() > 2
+          and m_mapping.find(predDFGNode) != m_mapping.end()) {
+        if (m_mapping[predDFGNode] == targetCGRANode)
+          cost -= 0.5;
       }
     }
+  }
 
-    /*
-    // Prefer to map the DFG nodes from left to right rather than
-    // always picking CGRA node at left.
-    if (t_dfgNode->getPredNodes()->size() > 0) {
-      list<DFGNode*>* tempPredNodes = t_dfgNode->getPredNodes();
-      for (DFGNode* predDFGNode: *tempPredNodes) {
-        if (m_mapping.find(predDFGNode) != m_mapping.end()) {
-          if (m_mapping[predDFGNode]->getX() > targetCGRANode->getX() or
-              m_mapping[predDFGNode]->getY() > targetCGRANode->getY()) {
-            cost += 0.5;
-          }
-        }
-      }
-    }
-    */
-
-    // Consider the cost of that the DFG node with multiple successor
-    // might potentially occupy the surrounding CGRA nodes.
-    list<CGRANode*>* neighbors = targetCGRANode->getNeighbors();
-    for (CGRANode* neighbor: *neighbors) {
-      list<DFGNode*>* dfgNodes = getMappedDFGNodes(t_dfg, neighbor);
-      for (DFGNode* dfgNode: *dfgNodes) {
-        if (dfgNode->getSuccNodes()->size() > 2) {
-          cost += 0.4;
+  /*
+  // Prefer to map the DFG nodes from left to right rather than
+  // always picking CGRA node at left.
+  if (t_dfgNode->getPredNodes()->size() > 0) {
+    list<DFGNode*>* tempPredNodes = t_dfgNode->getPredNodes();
+    for (DFGNode* predDFGNode: *tempPredNodes) {
+      if (m_mapping.find(predDFGNode) != m_mapping.end()) {
+        if (m_mapping[predDFGNode]->getX() > targetCGRANode->getX() or
+            m_mapping[predDFGNode]->getY() > targetCGRANode->getY()) {
+          cost += 0.5;
         }
       }
     }
-
-    // Consider the cost of occupying the leftmost (rightmost) CGRA
-    // nodes that are reserved for load.
-    if ((!t_dfgNode->isLoad() and targetCGRANode->canLoad()) or
-        (!t_dfgNode->isStore() and targetCGRANode->canStore())) {
-      cost += 2;
-    }
-
-    // Consider the bonus of reusing the same link for delivery the
-    // same data to different destination CGRA nodes (multicast).
-    lastCGRANodeItr=reorderPath->begin();
-    for (map<int, CGRANode*>::iterator cgraNodeItr=reorderPath->begin();
-        cgraNodeItr!=reorderPath->end(); ++cgraNodeItr) {
-      if (cgraNodeItr != reorderPath->begin()) {
-        CGRANode* left = (*lastCGRANodeItr).second;
-        CGRANode* right = (*cgraNodeItr).second;
-        int leftCycle = (*lastCGRANodeItr).first;
-//        errs()<<"$$$$$$$$$$ wrong?! left node: "<<left->getID()<<" -> right node: "<<right->getID()<<"\n";
-        CGRALink* l = left->getOutLink(right);
-        if (l != NULL and l->isReused(leftCycle)) {
-          cost -= 0.5;
-        }
+  }
+  */
+
+  // Consider the cost of that the DFG node with multiple successor
+  // might potentially occupy the surrounding CGRA nodes.
+  list<CGRANode*>* neighbors = targetCGRANode->getNeighbors();
+  for (CGRANode* neighbor: *neighbors) {
+    for (DFGNode* mappedDFGNode: *getMappedDFGNodes(neighbor)) {
+      if (mappedDFGNode->getSuccNodes()->size() > 2) {
+        cost += 0.4;
       }
-      lastCGRANodeItr = cgraNodeItr;
     }
+  }
 
-    // Consider the bonus of available links on the target CGRA nodes.
-    cost -= targetCGRANode->getOccupiableInLinks(targetCycle, t_II)->size()*0.3 +
-        targetCGRANode->getOccupiableOutLinks(targetCycle, t_II)->size()*0.3;
-
-    (*pathsWithCost)[*path] = cost;
+  // Consider the cost of occupying the leftmost (rightmost) CGRA
+  // nodes that are reserved for load.
+  if ((!t_dfgNode->isLoad() and targetCGRANode->canLoad()) or
+      (!t_dfgNode->isStore() and targetCGRANode->canStore())) {
+    cost += 2;
   }
 
-  list<map<CGRANode*, int>*>* potentialPaths = new list<map<CGRANode*, int>*>();
-  while(pathsWithCost->size() != 0) {
-    float minCost = (*pathsWithCost->begin()).second;
-    map<CGRANode*, int>* currentPath = (*pathsWithCost->begin()).first;
-    for (map<map<CGRANode*, int>*, float>::iterator pathItr=pathsWithCost->begin();
-        pathItr!=pathsWithCost->end(); ++pathItr) {
-      if ((*pathItr).second < minCost) {
-        minCost = (*pathItr).second;
-        currentPath = (*pathItr).first;
-      }
+  // Consider the bonus of reusing the same link for delivery the
+  // same data to different destination CGRA nodes (multicast).
+  for (int i=1; i<t_length; ++i) {
+    CGRANode* left = t_path[i-1].tile;
+    CGRANode* right = t_path[i].tile;
+    int leftCycle = t_path[i-1].cycle;
+    CGRALink* l = left->getOutLink(right);
+    if (l != NULL and l->isReused(leftCycle)) {
+      cost -= 0.5;
     }
-    pathsWithCost->erase(currentPath);
-    potentialPaths->push_back(currentPath);
   }
 
-  delete pathsWithCost;
-  return potentialPaths;
+  // Consider the bonus of available links on the target CGRA nodes.
+  cost -= targetCGRANode->getOccupiableInLinks(targetCycle, t_II)->size()*0.3 +
+      targetCGRANode->getOccupiableOutLinks(targetCycle, t_II)->size()*0.3;
+  return cost;
 }
 
-map<CGRANode*, int>* Mapper::getPathWithMinCostAndConstraints(CGRA* t_cgra,
-    DFG* t_dfg, int t_II, DFGNode* t_dfgNode, list<map<CGRANode*, int>*>* t_paths) {
-
-  list<map<CGRANode*, int>*>* potentialPaths =
-      getOrderedPotentialPaths(t_cgra, t_dfg, t_II, t_dfgNode, t_paths);
-
-  // The paths are already ordered well based on the cost in getPotentialPaths().
-  list<map<CGRANode*, int>*>::iterator pathItr=potentialPaths->begin();
-  return (*pathItr);
+// Fills 't_order' with the paths of the arena ordered by their cost. The
+// paths with the same cost keep the order they were found in. The paths
+// placing the node at a cycle that breaks a recurrence are left out.
+void Mapper::getOrderedPotentialPaths(CGRA* t_cgra, int t_II,
+    DFGNode* t_dfgNode, PathArena* t_paths, vector<int>* t_order) {
+  m_pathCosts.resize(t_paths->getPathCount());
+  t_order->clear();
+  for (int path=0; path<t_paths->getPathCount(); ++path) {
+    int cycle = t_paths->getTarget(path)->cycle;
+    if (cycle >= m_maxMappingCycle or
+        m_recurrences.wouldViolate(t_dfgNode, cycle))
+      continue;
+    m_pathCosts[path] = getPathCost(t_cgra, t_II, t_dfgNode,
+        t_paths->getPath(path), t_paths->getPathLength(path));
+    t_order->push_back(path);
+  }
+  stable_sort(t_order->begin(), t_order->end(), [this](int a, int b) {
+    return m_pathCosts[a] < m_pathCosts[b];
+  });
 }
 
-list<DFGNode*>* Mapper::getMappedDFGNodes(DFG* t_dfg, CGRANode* t_cgraNode) {
-  list<DFGNode*>* dfgNodes = new list<DFGNode*>();
-  for (DFGNode* dfgNode: t_dfg->nodes) {
-    if (m_mapping.find(dfgNode) != m_mapping.end())
-      if ( m_mapping[dfgNode] == t_cgraNode)
-        dfgNodes->push_back(dfgNode);
+// Only the cheapest path is needed, the first one wins the ties. Returns
+// -1 if no path is within the maximum mapping cycle and the recurrences.
+int Mapper::getPathWithMinCostAndConstraints(CGRA* t_cgra, int t_II,
+    DFGNode* t_dfgNode, PathArena* t_paths) {
+  int optimalPath = -1;
+  float minCost = 0;
+  for (int path=0; path<t_paths->getPathCount(); ++path) {
+    int cycle = t_paths->getTarget(path)->cycle;
+    if (cycle >= m_maxMappingCycle or
+        m_recurrences.wouldViolate(t_dfgNode, cycle))
+      continue;
+    float cost = getPathCost(t_cgra, t_II, t_dfgNode,
+        t_paths->getPath(path), t_paths->getPathLength(path));
+    if (optimalPath == -1 or cost < minCost) {
+      minCost = cost;
+      optimalPath = path;
+    }
   }
-  return dfgNodes;
+  return optimalPath;
 }
 
 // TODO: will grant award for the overuse the same link for the
 //       same data delivery
-map<CGRANode*, int>* Mapper::calculateCost(CGRA* t_cgra, DFG* t_dfg,
-    int t_II, DFGNode* t_dfgNode, CGRANode* t_fu, bool PrintMappingFailures) {
+// Adds the path of placing 't_dfgNode' onto 't_fu' into the arena and
+// returns its index, or -1 if 't_fu' is not a candidate.
+int Mapper::calculateCost(CGRA* t_cgra, int t_II,
+    DFGNode* t_dfgNode, CGRANode* t_fu, PathArena* t_paths,
+    bool PrintMappingFailures) {
   //cout<<"...calculateCost() for dfgNode "<<t_dfgNode->getID()<<" on tile "<<t_fu->getID()<<endl;
-  map<CGRANode*, int>* path = NULL;
   list<DFGNode*>* predNodes = t_dfgNode->getPredNodes();
   int latest = -1;
   bool isAnyPredDFGNodeMapped = false;
   for(DFGNode* pre: *predNodes) {
-//      errs()<<"[TAN DEBUG] how dare to pre node: "<<pre->getID()<<"; CGRA node: "<<t_fu->getID()<<"\n";
     if(m_mapping.find(pre) != m_mapping.end()) {
       // Leverage Dijkstra algorithm to search the shortest path between
       // the mapped 'CGRANode' of the 'pre' and the target 'fu'.
-      map<CGRANode*, int>* tempPath = NULL;
-      if (t_fu->canSupport(t_dfgNode))
-        tempPath = dijkstra_search(t_cgra, t_dfg, t_II, pre,
-            t_dfgNode, t_fu); 
-	  else {
-		  // cout << "Failed to support " << t_dfgNode->getOperation() << " on node " << t_fu->getX() << ", " << t_fu->getY() << endl;
-		  // t_fu->print_operations();
-	  }
-      if (tempPath == NULL)
-        return NULL;
-      else if ((*tempPath)[t_fu] >= m_maxMappingCycle) {
-        delete tempPath;
-        return NULL;
-      }
-      if ((*tempPath)[t_fu] > latest) {
-        latest = (*tempPath)[t_fu];
-        path = tempPath;
+      if (!t_fu->canSupport(t_dfgNode) or
+          !dijkstra_search(t_cgra, t_II, pre, t_dfgNode, t_fu,
+                           &m_searchPath))
+        return -1;
+      int cycle = m_searchPath.back().cycle;
+      if (cycle >= m_maxMappingCycle)
+        return -1;
+      // Keep the path of the predecessor whose data arrives the latest.
+      if (cycle > latest) {
+        latest = cycle;
+        m_latestPath.swap(m_searchPath);
       }
       isAnyPredDFGNodeMapped = true;
     }
   }
+  if (isAnyPredDFGNodeMapped)
+    return t_paths->addPath(&m_latestPath);
+
   // TODO: should not be any CGRA node, should consider the memory access.
   // TODO  A DFG node can be mapped onto any CGRA node if no predecessor
   //       of it has been mapped.
   // TODO: should also consider the current config mem iterms.
-  if (!isAnyPredDFGNodeMapped) {
-    if (!t_fu->canSupport(t_dfgNode)) {
-		  // cout << "Failed to support " << t_dfgNode->getOperation() << " on node " << t_fu->getX() << ", " << t_fu->getY() << endl;
-		  // t_fu->print_operations();
-      return NULL;
-	}
-    int cycle = 0;
-    while (cycle < m_maxMappingCycle) {
-      if (t_fu->canOccupy(t_dfgNode, cycle, t_II)) {
-        path = new map<CGRANode*, int>();
-        (*path)[t_fu] = cycle;
-        //cout<<"DEBUG how dare to map DFG node: "<<t_dfgNode->getID()<<"; CGRA node: "<<t_fu->getID()<<" at cycle "<< cycle<<endl;
-        return path;
-      }
-      ++cycle;
-    }
-//    errs() << "DEBUG: failed in mapping the starting DFG node "<<t_dfg->getID(t_dfgNode)<<" on CGRA node "<<t_fu->getID()<<"\n";
+  if (!t_fu->canSupport(t_dfgNode))
+    return -1;
+  int cycle = t_fu->getMinIdleCycle(t_dfgNode, 0, t_II);
+  if (cycle < m_maxMappingCycle) {
+    PathStep step = {cycle, t_fu};
+    m_latestPath.assign(1, step);
+    return t_paths->addPath(&m_latestPath);
   }
-//  cout<<".....in calculate cost path"<<endl;
-//  for (map<CGRANode*, int>::iterator iter=path->begin();
-//        iter!=path->end(); ++iter) {
-//    cout<<"(tile:"<<(*iter).first->getID()<<", cycle:"<<(*iter).second<<") --";
-//  }
-//  cout<<endl;
-  return path;
+  return -1;
 }
 
 // Schedule is based on the modulo II, the 'path' contains one
 // predecessor that can be definitely mapped, but the pathes
 // containing other predecessors have possibility to fail in mapping.
+// The 't_length' steps of 't_path' are ordered by cycle.
 // Returns the cycle this was scheduled at, or -1 on a fail.
-int Mapper::schedule(CGRA* t_cgra, DFG* t_dfg, int t_II,
-    DFGNode* t_dfgNode, map<CGRANode*, int>* t_path, bool t_isStaticElasticCGRA) {
+int Mapper::schedule(CGRA* t_cgra, int t_II,
+    DFGNode* t_dfgNode, PathStep* t_path, int t_length,
+    bool t_isStaticElasticCGRA) {
 
-  map<int, CGRANode*>* reorderPath = getReorderPath(t_path);
-//
-//  // Since cycle on path increases gradually, re-order will not miss anything.
-//  for (map<CGRANode*, int>::iterator iter=t_path->begin(); iter!=t_path->end(); ++iter)
-//    reorderPath[(*iter).second] = (*iter).first;
-//  assert(reorderPath.size() == t_path->size());
+  // The routing trees are no longer valid once the MRRG is updated.
+  clearRoutingTrees();
 
-  map<int, CGRANode*>::reverse_iterator ri = reorderPath->rbegin();
-  CGRANode* fu = (*ri).second;
-  // errs()<<"schedule dfg node["<<t_dfg->getID(t_dfgNode)<<"] onto fu["<<fu->getID()<<"] at cycle "<<(*t_path)[fu]<<" within II: "<<t_II<<"\n";
+  PathStep* target = &t_path[t_length - 1];
+  CGRANode* fu = target->tile;
+  // errs()<<"schedule dfg node["<<t_dfg->getID(t_dfgNode)<<"] onto fu["<<fu->getID()<<"] at cycle "<<target->cycle<<" within II: "<<t_II<<"\n";
 
   // Map the DFG node onto the CGRA nodes across cycles.
   m_mapping[t_dfgNode] = fu;
-  fu->setDFGNode(t_dfgNode, (*t_path)[fu], t_II, t_isStaticElasticCGRA);
-  m_mappingTiming[t_dfgNode] = (*t_path)[fu];
+  m_tileNodes[fu->getID()].push_back(t_dfgNode);
+  fu->setDFGNode(t_dfgNode, target->cycle, t_II, t_isStaticElasticCGRA);
+  m_mappingTiming[t_dfgNode] = target->cycle;
+  m_recurrences.schedule(t_dfgNode, target->cycle);
 
   // Route the dataflow onto the CGRA links across cycles.
-  CGRANode* onePredCGRANode;
-  int onePredCGRANodeTiming;
-  map<int, CGRANode*>::iterator previousIter;
-  map<int, CGRANode*>::iterator next;
-  int scheduled_cycle = -1;
-  if (reorderPath->size() > 0) {
-    next = reorderPath->begin();
-    if (next != reorderPath->end())
-      ++next;
-  }
-  map<int, CGRANode*>::reverse_iterator riter=reorderPath->rbegin();
+  CGRANode* onePredCGRANode = t_path[0].tile;
+  int onePredCGRANodeTiming = t_path[0].cycle;
+  // TODO --- handle that duration thing.
   bool generatedOut = true;
-  for (map<int, CGRANode*>::iterator iter=reorderPath->begin();
-      iter!=reorderPath->end(); ++iter) {
-    if (iter != reorderPath->begin()) {
-      CGRANode* srcCGRANode = (*(reorderPath->begin())).second;
-      int srcCycle = (*(reorderPath->begin())).first;
-      CGRALink* l = t_cgra->getLink((*previousIter).second, (*iter).second);
-
-      // Distinguish the bypassed and utilized data delivery on xbar.
-      bool isBypass = false;
-      int duration = (t_II+((*iter).first-(*previousIter).first)%t_II)%t_II;
-      if ((*riter).second != (*iter).second and
-          (*previousIter).first+1 == (*iter).first)
-        isBypass = true;
-      else
-        duration = (m_mappingTiming[t_dfgNode]-(*previousIter).first)%t_II;
-      // errs()<<"[cheng] occupy reserved link...\n";
-      l->occupy(srcCGRANode->getMappedDFGNode(srcCycle),
-                (*previousIter).first, duration,
-                t_II, isBypass, generatedOut, t_isStaticElasticCGRA);
-      generatedOut = false;
-    } else {
-      onePredCGRANode = (*iter).second;
-      onePredCGRANodeTiming = (*iter).first;
-	  // TODO --- handle that duration thing.
-    }
-    previousIter = iter;
+  for (int i=1; i<t_length; ++i) {
+    PathStep* previous = &t_path[i-1];
+    PathStep* current = &t_path[i];
+    CGRANode* srcCGRANode = t_path[0].tile;
+    int srcCycle = t_path[0].cycle;
+    CGRALink* l = t_cgra->getLink(previous->tile, current->tile);
+
+    // Distinguish the bypassed and utilized data delivery on xbar.
+    bool isBypass = false;
+    int duration = (t_II+(current->cycle-previous->cycle)%t_II)%t_II;
+    if (fu != current->tile and previous->cycle+1 == current->cycle)
+      isBypass = true;
+    else
+      duration = (m_mappingTiming[t_dfgNode]-previous->cycle)%t_II;
+    // errs()<<"[cheng] occupy reserved link...\n";
+    l->occupy(srcCGRANode->getMappedDFGNode(srcCycle),
+              previous->cycle, duration,
+              t_II, isBypass, generatedOut, t_isStaticElasticCGRA);
+    generatedOut = false;
   }
-  delete reorderPath;
 
   // Try to route the path with other predecessors.
   // TODO: should consider the timing for static CGRA (two branches should
@@ -477,9 +563,10 @@ int Mapper::schedule(CGRA* t_cgra, DFG* t_dfg, int t_II,
         continue;
       }
 //      if (m_mapping[(node)] != onePredCGRANode) {
-      if (!tryToRoute(t_cgra, t_dfg, t_II, node, m_mapping[node], t_dfgNode, fu,
+      if (!tryToRoute(t_cgra, t_II, node, m_mapping[node], t_dfgNode, fu,
           m_mappingTiming[t_dfgNode], false, t_isStaticElasticCGRA)){
-        cout<<"DEBUG target DFG node: "<<t_dfgNode->asString()<<" on fu: "<<fu->getID()<<" failed, mapped pred DFG node: "<<node->getID()<<"; return -1\n";
+        if (!m_quiet)
+          cout<<"DEBUG target DFG node: "<<t_dfgNode->asString()<<" on fu: "<<fu->getID()<<" failed, mapped pred DFG node: "<<node->getID()<<"; return -1\n";
         return -1;
       }
 //    }
@@ -501,9 +588,10 @@ int Mapper::schedule(CGRA* t_cgra, DFG* t_dfg, int t_II,
 	  if (max_cycle < m_mappingTiming[node]) {
 		  max_cycle = m_mappingTiming[node];
 	  }
-      if (!tryToRoute(t_cgra, t_dfg, t_II, t_dfgNode, fu, node, m_mapping[node],
+      if (!tryToRoute(t_cgra, t_II, t_dfgNode, fu, node, m_mapping[node],
           m_mappingTiming[node], bothNodesInCycle, t_isStaticElasticCGRA)) {
-        cout<<"DEBUG target DFG node: "<<t_dfgNode->getID()<<" on fu: "<<fu->getID()<<" failed, mapped succ DFG node: "<<node->getID()<<"; return -1\n";
+        if (!m_quiet)
+          cout<<"DEBUG target DFG node: "<<t_dfgNode->getID()<<" on fu: "<<fu->getID()<<" failed, mapped succ DFG node: "<<node->getID()<<"; return -1\n";
         return -1;
       }
     }
@@ -551,24 +639,15 @@ void Mapper::showSchedule(CGRA* t_cgra, DFG* t_dfg, MapResult *res,
     for (int i=0; i<t_cgra->getRows(); ++i) {
       for (int j=0; j<t_cgra->getColumns(); ++j) {
 
+        // The node shows up on its tile from its cycle on, every II cycles.
         bool fu_occupied = false;
         DFGNode* dfgNode;
-        for (DFGNode* currentDFGNode: t_dfg->nodes) {
-          if (m_mappingTiming[currentDFGNode] == cycle and
-              m_mapping[currentDFGNode] == t_cgra->nodes[i][j]) {
+        for (DFGNode* currentDFGNode: *getMappedDFGNodes(t_cgra->nodes[i][j])) {
+          int timing = m_mappingTiming[currentDFGNode];
+          if (timing <= cycle and (cycle - timing) % res->II() == 0) {
             fu_occupied = true;
             dfgNode = currentDFGNode;
             break;
-          } else if (m_mapping[currentDFGNode] == t_cgra->nodes[i][j]) {
-            int temp_cycle = cycle - res->II();
-            while (temp_cycle >= 0) {
-              if (m_mappingTiming[currentDFGNode] == temp_cycle) {
-                fu_occupied = true;
-                dfgNode = currentDFGNode;
-                break;
-              }
-              temp_cycle -= res->II();
-            }
           }
         }
         string str_fu;
@@ -588,15 +667,15 @@ void Mapper::showSchedule(CGRA* t_cgra, DFG* t_dfg, MapResult *res,
           string str_link = "";
           CGRALink* lu = t_cgra->getLink(t_cgra->nodes[i][j], t_cgra->nodes[i+1][j]);
           CGRALink* ld = t_cgra->getLink(t_cgra->nodes[i+1][j], t_cgra->nodes[i][j]);
-          if (ld->isOccupied(cycle, res->II(), t_isStaticElasticCGRA) and
-              lu->isOccupied(cycle, res->II(), t_isStaticElasticCGRA)) {
+          if (ld->isOccupied(cycle, t_isStaticElasticCGRA) and
+              lu->isOccupied(cycle, t_isStaticElasticCGRA)) {
             str_link = "   \u21c5 ";
-          } else if (ld->isOccupied(cycle, res->II(), t_isStaticElasticCGRA)) {
+          } else if (ld->isOccupied(cycle, t_isStaticElasticCGRA)) {
             if (!ld->isBypass(cycle))
               str_link = "   \u2193 ";
             else
               str_link = "   \u2193 ";
-          } else if (lu->isOccupied(cycle, res->II(), t_isStaticElasticCGRA)) {
+          } else if (lu->isOccupied(cycle, t_isStaticElasticCGRA)) {
             if (!lu->isBypass(cycle))
               str_link = "   \u2191 ";
             else
@@ -610,15 +689,15 @@ void Mapper::showSchedule(CGRA* t_cgra, DFG* t_dfg, MapResult *res,
           string str_link = "";
           CGRALink* lr = t_cgra->getLink(t_cgra->nodes[i][j], t_cgra->nodes[i][j+1]);
           CGRALink* ll = t_cgra->getLink(t_cgra->nodes[i][j+1], t_cgra->nodes[i][j]);
-          if (ll->isOccupied(cycle, res->II(), t_isStaticElasticCGRA) and
-              ll->isOccupied(cycle, res->II(), t_isStaticElasticCGRA)) {
+          if (ll->isOccupied(cycle, t_isStaticElasticCGRA) and
+              ll->isOccupied(cycle, t_isStaticElasticCGRA)) {
             str_link = " \u21c4 ";
-          } else if (ll->isOccupied(cycle, res->II(), t_isStaticElasticCGRA)) {
+          } else if (ll->isOccupied(cycle, t_isStaticElasticCGRA)) {
             if (!ll->isBypass(cycle))
               str_link = " \u2192 ";
             else
               str_link = " \u2192 ";
-          } else if (ll->isOccupied(cycle, res->II(), t_isStaticElasticCGRA)) {
+          } else if (ll->isOccupied(cycle, t_isStaticElasticCGRA)) {
             if (!ll->isBypass(cycle))
               str_link = " \u2190 ";
             else
@@ -672,7 +751,7 @@ void Mapper::showSchedule(CGRA* t_cgra, DFG* t_dfg, MapResult *res,
   ofile.close();
 }
 
-void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
+void Mapper::generateJSON(CGRA* t_cgra, MapResult *r,
     bool t_isStaticElasticCGRA) {
   ofstream jsonFile;
   jsonFile.open("config.json");
@@ -686,13 +765,11 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
       for (int i=0; i<t_cgra->getRows(); ++i) {
         for (int j=0; j<t_cgra->getColumns(); ++j) {
           CGRANode* currentCGRANode = t_cgra->nodes[i][j];
-          DFGNode* targetDFGNode = NULL;
-          for (DFGNode* dfgNode: t_dfg->nodes) {
-            if (m_mapping[dfgNode] == currentCGRANode and
-                currentCGRANode->getMappedDFGNode(t) == dfgNode) {
-              targetDFGNode = dfgNode;
-              break;
-            }
+          // The MRRG of the tile already tells the node of the cycle.
+          DFGNode* targetDFGNode = currentCGRANode->getMappedDFGNode(t);
+          if (targetDFGNode != NULL and
+              m_mapping[targetDFGNode] != currentCGRANode) {
+            targetDFGNode = NULL;
           }
           list<CGRALink*>* inLinks = currentCGRANode->getInLinks();
           list<CGRALink*>* outLinks = currentCGRANode->getOutLinks();
@@ -701,13 +778,13 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
             hasInform = true;
           } else {
             for (CGRALink* il: *inLinks) {
-              if (il->isOccupied(t, r->II(), t_isStaticElasticCGRA)) {
+              if (il->isOccupied(t, t_isStaticElasticCGRA)) {
                 hasInform = true;
                 break;
               }
             }
             for (CGRALink* ol: *outLinks) {
-              if (ol->isOccupied(t, r->II(), t_isStaticElasticCGRA)) {
+              if (ol->isOccupied(t, t_isStaticElasticCGRA)) {
                 hasInform = true;
                 break;
               }
@@ -739,7 +816,7 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
 
           // Handle predicate based on inports.
           for (CGRALink* il: *inLinks) {
-            if (il->isOccupied(t, r->II(), t_isStaticElasticCGRA) and
+            if (il->isOccupied(t, t_isStaticElasticCGRA) and
                 il->getMappedDFGNode(t)->isPredicater()) {
               if (predicate_in != "") {
                 predicate_in += ",";
@@ -775,7 +852,7 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
             targetOpt = targetDFGNode->getJSONOpt();
             // handle funtion unit's outputs for this cycle
             for (CGRALink* ol: *outLinks) {
-              if (ol->isOccupied(t, r->II(), t_isStaticElasticCGRA) and
+              if (ol->isOccupied(t, t_isStaticElasticCGRA) and
                   ol->getMappedDFGNode(t) == targetDFGNode) {
                 // FIXME: should support multiple outputs and distinguish them.
                 stringDst[ol->getDirectionID(currentCGRANode)] = "4";
@@ -785,7 +862,7 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
 //              if (i==1 and j==1 and il->getMappedDFGNode(t) != NULL)
 //                errs()<<"il->getMappedDFGNode("<<t<<"): "<<il->getMappedDFGNode(t)->getID()<<"; link: "<<il->getDirection(currentCGRANode)<<"; nextDFGNode: "<<nextDFGNode->getID()<<"\n";
 //
-//              if (il->isOccupied(t, r->II(), t_isStaticElasticCGRA) and
+//              if (il->isOccupied(t, t_isStaticElasticCGRA) and
 //                  il->getMappedDFGNode(t) == nextDFGNode) {
 //                stringDst[out_index++] = to_string(il->getDirectionID(currentCGRANode))+" (never happen?)";
 //                assert(out_index <= max_index+1);
@@ -821,7 +898,7 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
           // handle bypass: need consider next cycle, i.e., t+1
           int next_t = t+1;
           for (CGRALink* ol: *outLinks) {
-            if (ol->isOccupied(next_t, r->II(), t_isStaticElasticCGRA)) {
+            if (ol->isOccupied(next_t, t_isStaticElasticCGRA)) {
               int outIndex = -1;
               outIndex = ol->getDirectionID(currentCGRANode);
               // skip the outport as function unit inport, since they are
@@ -829,7 +906,7 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
               if (outIndex>=4) continue;
               for (CGRALink* il: *inLinks) {
                 for (int t_tmp=next_t-r->II(); t_tmp<next_t; ++t_tmp) {
-                  if (il->isOccupied(t_tmp, r->II(), t_isStaticElasticCGRA) and
+                  if (il->isOccupied(t_tmp, t_isStaticElasticCGRA) and
                       il->isBypass(t_tmp) and
                       il->getMappedDFGNode(t_tmp) == ol->getMappedDFGNode(next_t)) {
                     // cout<<"[cheng] inside roi for CGRA node "<<currentCGRANode->getID()<<"...\n";
@@ -863,11 +940,8 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
     for (int j=0; j<t_cgra->getColumns(); ++j) {
       CGRANode* currentCGRANode = t_cgra->nodes[i][j];
       DFGNode* targetDFGNode = NULL;
-      for (DFGNode* dfgNode: t_dfg->nodes) {
-        if (m_mapping[dfgNode] == currentCGRANode) {
-          targetDFGNode = dfgNode;
-          break;
-        }
+      if (!getMappedDFGNodes(currentCGRANode)->empty()) {
+        targetDFGNode = getMappedDFGNodes(currentCGRANode)->front();
       }
       list<CGRALink*>* inLinks = currentCGRANode->getInLinks();
       list<CGRALink*>* outLinks = currentCGRANode->getOutLinks();
@@ -876,13 +950,13 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
         hasInform = true;
       } else {
         for (CGRALink* il: *inLinks) {
-          if (il->isOccupied(0, r->II(), t_isStaticElasticCGRA)) {
+          if (il->isOccupied(0, t_isStaticElasticCGRA)) {
             hasInform = true;
             break;
           }
         }
         for (CGRALink* ol: *outLinks) {
-          if (ol->isOccupied(0, r->II(), t_isStaticElasticCGRA)) {
+          if (ol->isOccupied(0, t_isStaticElasticCGRA)) {
             hasInform = true;
             break;
           }
@@ -912,7 +986,7 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
       if (targetDFGNode != NULL) {
         targetOpt = targetDFGNode->getOpcodeName();
         for (CGRALink* il: *inLinks) {
-          if (il->isOccupied(0, r->II(), t_isStaticElasticCGRA)
+          if (il->isOccupied(0, t_isStaticElasticCGRA)
               and !il->isBypass(0)) {
             if (targetDFGNode->isBranch() and
                 il->getMappedDFGNode(0)->isCmp()) {
@@ -923,7 +997,7 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
             } else {
               stringSrc[stringDstIndex++] = il->getDirection(currentCGRANode);
             }
-          } else if (il->isOccupied(0, r->II(), t_isStaticElasticCGRA) and 
+          } else if (il->isOccupied(0, t_isStaticElasticCGRA) and 
               il->isBypass(0) and
               il->getMappedDFGNode(0)->isPredecessorOf(targetDFGNode)) {
             // This is the case that the data is used in the CGRA node and
@@ -943,7 +1017,7 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
         }
         stringDstIndex = 0;
         for (CGRALink* ir: *outLinks) {
-          if (ir->isOccupied(0, r->II(), t_isStaticElasticCGRA)
+          if (ir->isOccupied(0, t_isStaticElasticCGRA)
               and ir->getMappedDFGNode(0) == targetDFGNode) {
             stringDst[stringDstIndex++] = ir->getDirection(currentCGRANode);
           }
@@ -952,12 +1026,12 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
       DFGNode* bpsDFGNode = NULL;
       map<string, list<string>> stringBpsSrcDstMap;
       for (CGRALink* il: *inLinks) {
-        if (il->isOccupied(0, r->II(), t_isStaticElasticCGRA)
+        if (il->isOccupied(0, t_isStaticElasticCGRA)
             and il->isBypass(0)) {
           bpsDFGNode = il->getMappedDFGNode(0);
           list<string> stringBpsDst;
           for (CGRALink* ir: *outLinks) {
-            if (ir->isOccupied(0, r->II(), t_isStaticElasticCGRA)
+            if (ir->isOccupied(0, t_isStaticElasticCGRA)
                 and ir->getMappedDFGNode(0) == bpsDFGNode) {
               stringBpsDst.push_back(ir->getDirection(currentCGRANode));
             }
@@ -1020,125 +1094,38 @@ void Mapper::generateJSON(CGRA* t_cgra, DFG* t_dfg, MapResult *r,
 // TODO: Should consider the unmapped predecessors.
 // TODO: Should consider the type of CGRA, say, a static in-elastic CGRA should
 //       join at the same successor at exact same cycle without pending.
-bool Mapper::tryToRoute(CGRA* t_cgra, DFG* t_dfg, int t_II,
+bool Mapper::tryToRoute(CGRA* t_cgra, int t_II,
     DFGNode* t_srcDFGNode, CGRANode* t_srcCGRANode, DFGNode* t_dstDFGNode,
     CGRANode* t_dstCGRANode, int t_dstCycle, bool t_isBackedge,
     bool t_isStaticElasticCGRA) {
   // cout<<"[cheng] tryToRoute -- srcDFGNode: "<<t_srcDFGNode->getID()<<", srcCGRANode: "<<t_srcCGRANode->getID()<<"; dstDFGNode: "<<t_dstDFGNode->getID()<<", dstCGRANode: "<<t_dstCGRANode->getID()<<"; backEdge: "<<t_isBackedge<<endl;
-  list<CGRANode*> searchPool;
-  map<CGRANode*, int> distance;
-  map<CGRANode*, int> timing;
-  map<CGRANode*, CGRANode*> previous;
-  timing[t_srcCGRANode] = m_mappingTiming[t_srcDFGNode];
-  // Check whether the II is violated on each cycle.
-  if (t_srcDFGNode->shareSameCycle(t_dstDFGNode)) {
-    list<list<DFGNode*>*>* dfgNodeCycles = t_dfg->getCycleLists();
-    for (list<DFGNode*>* cycle: *dfgNodeCycles) {
-      bool foundSrc = (find(cycle->begin(), cycle->end(), t_srcDFGNode) != cycle->end());
-      bool foundDst = (find(cycle->begin(), cycle->end(), t_dstDFGNode) != cycle->end());
-      if (!foundSrc or !foundDst) {
-        continue;
-      }
-      int totalTime = 0;
-      DFGNode* lastDFGNode = cycle->back();
-      bool turned = false;
-      for (DFGNode* dfgNode: *cycle) {
-        if (m_mappingTiming.find(dfgNode) == m_mappingTiming.end() or
-            m_mappingTiming.find(lastDFGNode) == m_mappingTiming.end()) {
-          totalTime = 0;
-          break;
-        } else {
-          int t1 = m_mappingTiming[lastDFGNode];
-          int t2 = m_mappingTiming[dfgNode];
-          if (t1 >= t2) {
-            if (turned) {
-              return false;
-            }
-            t2 += t_II;
-            turned = true;
-            if (t1 >= t2) {
-              return false;
-            }
-          }
-          totalTime += t2 - t1;
-        }
-        lastDFGNode = dfgNode;
-      }
-      if (totalTime > t_II) {
-        cout<<"[DEBUG] cannot route due to II is violated"<<endl;
-        return false;
-      }
-    }
-  }
-  for (int i=0; i<t_cgra->getRows(); ++i) {
-    for (int j=0; j<t_cgra->getColumns(); ++j) {
-      CGRANode* node = t_cgra->nodes[i][j];
-      distance[node] = m_maxMappingCycle;
-      timing[node] = timing[t_srcCGRANode];
-      timing[node] += t_srcDFGNode->getExecLatency() - 1;
-//      if (t_srcDFGNode->isLoad() or t_srcDFGNode->isStore()) {
-//        timing[node] += 1;
-//      }
-      previous[node] = NULL;
-      searchPool.push_back(t_cgra->nodes[i][j]);
-    }
-  }
-  distance[t_srcCGRANode] = 0;
-  while (searchPool.size()!=0) {
-    int minCost = m_maxMappingCycle + 1;
-    CGRANode* minNode;
-    for (CGRANode* currentNode: searchPool) {
-      if (distance[currentNode] < minCost) {
-        minCost = distance[currentNode];
-        minNode = currentNode;
-      }
-    }
-    searchPool.remove(minNode);
-    // found the target point in the shortest path
-    if (minNode == t_dstCGRANode) {
-      if (previous[minNode] == NULL)
-        break;
-    }
-    list<CGRANode*>* currentNeighbors = minNode->getNeighbors();
-
-    for (CGRANode* neighbor: *currentNeighbors) {
-      int cycle = timing[minNode];
-      while (1) {
-        CGRALink* currentLink = minNode->getOutLink(neighbor);
-        // TODO: should also consider the cost of the register file
-        if (currentLink->canOccupy(t_srcDFGNode, t_srcCGRANode, cycle, t_II)) {
-          // rough estimate the cost based on the suspend cycle
-          int cost = distance[minNode] + (cycle - timing[minNode]) + 1;
-          if (cost < distance[neighbor]) {
-            distance[neighbor] = cost;
-            timing[neighbor] = cycle + 1;
-            previous[neighbor] = minNode;
-          }
-          break;
-        }
-        ++cycle;
-        if(cycle > m_maxMappingCycle)
-          break;
-      }
-    }
-  }
+  // Check whether the II is violated on the cycles of both nodes.
+  if (m_recurrences.isViolated(t_srcDFGNode, t_dstDFGNode))
+    return false;
+  int startCycle = m_mappingTiming[t_srcDFGNode] +
+      t_srcDFGNode->getExecLatency() - 1;
+  m_router->search(t_srcDFGNode, t_srcCGRANode, startCycle, t_II,
+      m_maxMappingCycle, t_dstCGRANode);
 
-  // Construct the shortest path for routing.
-  map<CGRANode*, int> path;
+  // Construct the shortest path for routing, ordered by cycle.
+  vector<PathStep>* path = &m_searchPath;
   CGRANode* u = t_dstCGRANode;
-  if (previous[u] != NULL or u == t_srcCGRANode) {
+  if (m_router->getPrevious(u) != NULL or u == t_srcCGRANode) {
+    path->clear();
     while (u != NULL) {
-      path[u] = timing[u];
-      u = previous[u];
+      PathStep step = {m_router->getTiming(u), u};
+      path->push_back(step);
+      u = m_router->getPrevious(u);
     }
+    reverse(path->begin(), path->end());
   } else {
     return false;
   }
 
   // Not a valid mapping if it exceeds the 'm_maxMappingCycle'.
-  // errs()<<"[TAN] check timing -- srcCGRANode("<<t_srcCGRANode->getID()<<":timing "<<timing[t_srcCGRANode]<<")->dstCGRANode("<<t_dstCGRANode->getID()<<":timing "<<timing[t_dstCGRANode]<<")\n";
-  if(timing[t_dstCGRANode] > m_maxMappingCycle or
-     timing[t_dstCGRANode] - timing[t_srcCGRANode] > t_II) {
+  // errs()<<"[TAN] check timing -- srcCGRANode("<<t_srcCGRANode->getID()<<":timing "<<m_router->getTiming(t_srcCGRANode)<<")->dstCGRANode("<<t_dstCGRANode->getID()<<":timing "<<m_router->getTiming(t_dstCGRANode)<<")\n";
+  if(m_router->getTiming(t_dstCGRANode) > m_maxMappingCycle or
+     m_router->getTiming(t_dstCGRANode) - startCycle > t_II) {
 // or
 //    }
     return false;
@@ -1146,154 +1133,526 @@ bool Mapper::tryToRoute(CGRA* t_cgra, DFG* t_dfg, int t_II,
 
 //  errs()<<"[CHENG] believes this is correct or wrong... timing[t_dstCGRANode]: "<<timing[t_dstCGRANode]<<" t_dstCycle: "<<t_dstCycle<<"\n";
 
-//  if (timing[t_dstCGRANode] > t_dstCycle) {
-//    if (timing[t_dstCGRANode] > t_dstCycle + t_II) {
-//      for (map<CGRANode*,int>::iterator iter = path.begin();
-//          iter!=path.end(); ++iter) {
-//        errs()<<"[tan] the failed path -- cycle: "<<(*iter).second<<" CGRANode: "<<(*iter).first->getID()<<"\n";
-//      }
-//      return false;
-//    }
-//  }
-
 //  if (timing[t_dstCGRANode]%t_II >= t_dstCycle%t_II)
   // Try to route the data flow.
-  map<int, CGRANode*>* reorderPath = getReorderPath(&path);
-//  //Since the cycle on path increases gradually, re-order will not miss anything.
-//  for(map<CGRANode*, int>::iterator iter=path.begin(); iter!=path.end(); ++iter) {
-//    reorderPath[(*iter).second] = (*iter).first;
-//  }
-//  assert(reorderPath.size() == path.size());
-
-  map<int, CGRANode*>::iterator previousIter;
-  map<int, CGRANode*>::reverse_iterator riter = reorderPath->rbegin();
-  // cout<<"[cheng] check route size: "<<reorderPath->size()<<"\n";
-  if (reorderPath->size() == 1) {
-    int duration = (t_II+(t_dstCycle-(*riter).first)%t_II)%t_II;
-    // cout<<"[cheng] allocate for local reg maintain... duration="<<duration<<" last cycle: "<<(*riter).first<<"\n";
-    (*riter).second->allocateReg(4, (*riter).first, duration, t_II);
+  PathStep* target = &path->back();
+  // cout<<"[cheng] check route size: "<<path->size()<<"\n";
+  if (path->size() == 1) {
+    int duration = (t_II+(t_dstCycle-target->cycle)%t_II)%t_II;
+    // cout<<"[cheng] allocate for local reg maintain... duration="<<duration<<" last cycle: "<<target->cycle<<"\n";
+    target->tile->allocateReg(4, target->cycle, duration, t_II);
   }
   bool generatedOut = true;
-  for (map<int, CGRANode*>::iterator iter = reorderPath->begin();
-      iter!=reorderPath->end(); ++iter) {
-    if (iter != reorderPath->begin()) {
-      CGRALink* l = t_cgra->getLink((*previousIter).second, (*iter).second);
-      bool isBypass = false;
-      int duration = ((*iter).first-(*previousIter).first)%t_II;
-      if ((*riter).second != (*iter).second and
-          (*previousIter).first+1 == (*iter).first)
-        isBypass = true;
-      else {
-        duration = (t_II+(t_dstCycle-(*previousIter).first)%t_II)%t_II;
-        // cout<<"[cheng] reset duration: "<<duration<<" t_dstCycle: "<<t_dstCycle<<" previous: "<<(*previousIter).first<<" II: "<<t_II<<"\n";
-      }
-      if (duration == 0) {
-        // cout<<"[cheng] reset duration is 0...\n";
-        // The successor can only be done within an interval of II, otherwise
-        // the II is no longer II but II*2.
-        if (t_isBackedge) {
-          return false;
-        }
-        duration = t_II;
+  for (unsigned i=1; i<path->size(); ++i) {
+    PathStep* previous = &(*path)[i-1];
+    PathStep* current = &(*path)[i];
+    CGRALink* l = t_cgra->getLink(previous->tile, current->tile);
+    bool isBypass = false;
+    int duration = (current->cycle-previous->cycle)%t_II;
+    if (target->tile != current->tile and
+        previous->cycle+1 == current->cycle)
+      isBypass = true;
+    else {
+      duration = (t_II+(t_dstCycle-previous->cycle)%t_II)%t_II;
+      // cout<<"[cheng] reset duration: "<<duration<<" t_dstCycle: "<<t_dstCycle<<" previous: "<<previous->cycle<<" II: "<<t_II<<"\n";
+    }
+    if (duration == 0) {
+      // cout<<"[cheng] reset duration is 0...\n";
+      // The successor can only be done within an interval of II, otherwise
+      // the II is no longer II but II*2.
+      if (t_isBackedge) {
+        return false;
       }
-      l->occupy(t_srcDFGNode, (*previousIter).first,
-                duration, t_II, isBypass, generatedOut, t_isStaticElasticCGRA);
-      generatedOut = false;
+      duration = t_II;
     }
-    previousIter = iter;
+    l->occupy(t_srcDFGNode, previous->cycle,
+              duration, t_II, isBypass, generatedOut, t_isStaticElasticCGRA);
+    generatedOut = false;
   }
 
-  map<int, CGRANode*>::iterator begin = reorderPath->begin();
-  map<int, CGRANode*>::reverse_iterator end = reorderPath->rbegin();
-
   // Check whether the backward data can be delivered within II.
   if (!t_isStaticElasticCGRA) {
-    if (t_isBackedge and (*end).first - (*begin).first >= t_II) {
+    if (t_isBackedge and target->cycle - path->front().cycle >= t_II) {
       return false;
     }
   }
   return true;
 }
 
-MapResult *Mapper::heuristicMap(Parameters *params, Options *opts, CGRA* t_cgra, DFG* t_dfg, int t_II) {
-  bool fail = false;
-int max_cycle = 0;
-  while (1) {
-	  if (opts->PrintMappingFailures) {
+// Maps the DFG nodes one by one (in the DFG order, or in 'm_nodeOrder' if
+// it is set) onto a fresh MRRG of the given II. The
+// latest cycle that is scheduled is accumulated into 't_maxCycle'. The
+// attempt is given up as soon as 't_bestII' (if any) drops to 't_II'.
+// A node that has a tile in 't_preferred' (if any) is first tried on that
+// tile alone, and only searched over all the tiles if it does not fit.
+// Up to 'opts->RepairBudget' times, a node that cannot be mapped rips up
+// the placement blocking it (see ripUp()) instead of failing the II.
+bool Mapper::heuristicMapAtII(Parameters *params, Options *opts,
+    CGRA* t_cgra, DFG* t_dfg, int t_II, int* t_maxCycle,
+    atomic<int>* t_bestII, map<DFGNode*, CGRANode*>* t_preferred) {
+  bool printFailures = opts->PrintMappingFailures and !m_quiet;
+  if (printFailures) {
     cout<<"----------------------------------------\n";
     cout<<"DEBUG start heuristic algorithm with II="<<t_II<<"\n";
-	  }
+  }
 
-    constructMRRG(t_dfg, t_cgra, t_II);
-    fail = false;
-    for (list<DFGNode*>::iterator dfgNode=t_dfg->nodes.begin();
-        dfgNode!=t_dfg->nodes.end(); ++dfgNode) {
-      list<map<CGRANode*, int>*> paths;
-      for (int i=0; i<t_cgra->getRows(); ++i) {
-        for (int j=0; j<t_cgra->getColumns(); ++j) {
-          CGRANode* fu = t_cgra->nodes[i][j];
-		  if (opts->PrintMappingFailures) {
-          errs()<<"DEBUG cgrapass: dfg node: "<<*(*dfgNode)->getInst()<<",["<<i<<"]["<<j<<"]\n";
+  constructMRRG(t_dfg, t_cgra, t_II);
+  // Ripping up needs the updates of the MRRG to be recorded.
+  if (opts->RepairBudget > 0)
+    t_cgra->setTrail(&m_trail);
+  list<DFGNode*>* nodeOrder = m_nodeOrder.empty() ? &t_dfg->nodes :
+                                                    &m_nodeOrder;
+  vector<DFGNode*> order(nodeOrder->begin(), nodeOrder->end());
+  vector<int> marks(order.size());
+  map<DFGNode*, int> repairs;
+  map<DFGNode*, CGRANode*> avoid;
+  int repairCount = 0;
+  bool fail = false;
+  PathArena paths;
+  vector<DFGNode*>::iterator dfgNode = order.begin();
+  // Rips up the placement blocking the node that cannot be mapped, as long
+  // as the budget allows, and moves 'dfgNode' to where the mapping goes on.
+  auto repair = [&]() {
+    if (repairCount >= opts->RepairBudget)
+      return false;
+    int position = ripUp(t_cgra, &order, &marks, dfgNode - order.begin(),
+                         ++repairs[*dfgNode], &avoid);
+    if (position == -1)
+      return false;
+    ++repairCount;
+    dfgNode = order.begin() + position;
+    return true;
+  };
+  while (dfgNode != order.end()) {
+    // Another attempt has already succeeded with a smaller II.
+    if (t_bestII != NULL and *t_bestII <= t_II) {
+      fail = true;
+      break;
+    }
+    m_congestion.clear();
+    paths.clear();
+    int optimalPath = -1;
+    if (t_preferred != NULL and t_preferred->count(*dfgNode) != 0) {
+      calculateCost(t_cgra, t_II, *dfgNode, (*t_preferred)[*dfgNode],
+                    &paths, printFailures);
+      if (paths.getPathCount() != 0)
+        optimalPath = getPathWithMinCostAndConstraints(t_cgra, t_II,
+                                                       *dfgNode, &paths);
+      if (optimalPath == -1)
+        paths.clear();
+    }
+    // A node that was ripped up keeps off its old tile, unless there is no
+    // other candidate.
+    CGRANode* avoided = NULL;
+    if (avoid.count(*dfgNode) != 0) {
+      avoided = avoid[*dfgNode];
+      avoid.erase(*dfgNode);
+    }
+    for (int i=0; optimalPath == -1 and i<t_cgra->getRows(); ++i) {
+      for (int j=0; j<t_cgra->getColumns(); ++j) {
+        CGRANode* fu = t_cgra->nodes[i][j];
+        if (fu == avoided)
+          continue;
+		  if (printFailures) {
+        errs()<<"DEBUG cgrapass: dfg node: "<<*(*dfgNode)->getInst()<<",["<<i<<"]["<<j<<"]\n";
 		}
-          map<CGRANode*, int>* tempPath =
-              calculateCost(t_cgra, t_dfg, t_II, *dfgNode, fu, opts->PrintMappingFailures);
-          if(tempPath != NULL and tempPath->size() != 0) {
-            paths.push_back(tempPath);
-          } else if (opts->PrintMappingFailures) {
-            cout<<"DEBUG no available path for DFG node "<<(*dfgNode)->getID()
-                <<" on CGRA node "<<fu->getID()<<" within II "<<t_II<<"; path size: "<<paths.size()<<".\n";
-          }
+        int tempPath = calculateCost(t_cgra, t_II, *dfgNode, fu,
+                                     &paths, printFailures);
+        if (tempPath == -1 and printFailures) {
+          cout<<"DEBUG no available path for DFG node "<<(*dfgNode)->getID()
+              <<" on CGRA node "<<fu->getID()<<" within II "<<t_II<<"; path size: "<<paths.getPathCount()<<".\n";
         }
       }
-	  if (opts->PrintMappingFailures) {
+    }
+    if (paths.getPathCount() == 0 and avoided != NULL)
+      calculateCost(t_cgra, t_II, *dfgNode, avoided, &paths,
+                    printFailures);
+	  if (printFailures) {
 		  cout << "Paths calculated: computing optimal paths\n";
 	  }
-      // Found some potential mappings.
-      if (paths.size() != 0) {
-        map<CGRANode*, int>* optimalPath =
-            getPathWithMinCostAndConstraints(t_cgra, t_dfg, t_II, *dfgNode, &paths);
-		if (opts->PrintMappingFailures) {
-			errs() << "For oepration " << *(*dfgNode)->getInst() << " have optimal path size " << optimalPath->size();
+    // Found some potential mappings.
+    if (paths.getPathCount() != 0) {
+      if (optimalPath == -1)
+        optimalPath = getPathWithMinCostAndConstraints(t_cgra, t_II,
+                                                       *dfgNode, &paths);
+		if (printFailures and optimalPath != -1) {
+			errs() << "For oepration " << *(*dfgNode)->getInst() << " have optimal path size " << paths.getPathLength(optimalPath);
 		}
-        if (optimalPath->size() != 0) {
-			int cycle = schedule(t_cgra, t_dfg, t_II, *dfgNode, optimalPath, params->isStaticElasticCGRA);
-			if (cycle > max_cycle) {
-				max_cycle = cycle;
+      if (optimalPath != -1) {
+			marks[dfgNode - order.begin()] = m_trail.mark();
+			int cycle = schedule(t_cgra, t_II, *dfgNode,
+			    paths.getPath(optimalPath), paths.getPathLength(optimalPath),
+			    params->isStaticElasticCGRA);
+			if (cycle > *t_maxCycle) {
+				*t_maxCycle = cycle;
 			}
-          if (cycle == -1) {
-			  if (opts->PrintMappingFailures) {
-            cout<<"DEBUG fail1 in schedule() II: "<<t_II<<"\n";
+        if (cycle == -1) {
+			  if (printFailures) {
+          cout<<"DEBUG fail1 in schedule() II: "<<t_II<<"\n";
 			  }
-            for (map<CGRANode*,int>::iterator iter = optimalPath->begin();
-                iter!=optimalPath->end(); ++iter) {
-				if (opts->PrintMappingFailures) {
-              cout<<"[tan] the failed path -- cycle: "<<(*iter).second<<" CGRANode: "<<(*iter).first->getID()<<"\n";
+          PathStep* failedPath = paths.getPath(optimalPath);
+          for (int i=0; i<paths.getPathLength(optimalPath); ++i) {
+				if (printFailures) {
+            cout<<"[tan] the failed path -- cycle: "<<failedPath[i].cycle<<" CGRANode: "<<failedPath[i].tile->getID()<<"\n";
 				}
-            }
+          }
 
-            fail = true;
-            break;
-          } else {
-		  if (opts->PrintMappingFailures) {
-          cout<<"DEBUG success in schedule()\n";
-		  }
-		  }
-        } else {
-			if (opts->PrintMappingFailures) {
-          cout<<"DEBUG fail2 in schedule() II: "<<t_II<<"\n";
-			}
+          m_failedDFGNode = *dfgNode;
+          if (repair())
+            continue;
           fail = true;
           break;
-        }
+        } else {
+		  if (printFailures) {
+        cout<<"DEBUG success in schedule()\n";
+		  }
+		  }
       } else {
+			if (printFailures) {
+        cout<<"DEBUG fail2 in schedule() II: "<<t_II<<"\n";
+			}
+        m_failedDFGNode = *dfgNode;
+        if (repair())
+          continue;
         fail = true;
-		if (opts->PrintMappingFailures) {
-        cout<<"DEBUG [else] no available path for DFG node "<<(*dfgNode)->getID()
-            <<" within II "<<t_II<<".\n";
+        break;
+      }
+    } else {
+      m_failedDFGNode = *dfgNode;
+		if (printFailures) {
+      cout<<"DEBUG [else] no available path for DFG node "<<(*dfgNode)->getID()
+          <<" within II "<<t_II<<".\n";
 		}
+      if (repair())
+        continue;
+      fail = true;
+      break;
+    }
+    ++dfgNode;
+  }
+  t_cgra->setTrail(NULL);
+  m_trail.clear();
+  return !fail;
+}
+
+// Maps the II with the routing selected by 'opts->Routing'. The greedy
+// routing is a single heuristicMapAtII() attempt, where the first net to
+// be routed keeps its link slots. The history routing runs up to
+// 'opts->RerouteRounds' attempts, each rerouting all the nets: the history
+// cost of the link slots the failing node could not get is raised, so the
+// nets routed before it move away from them in the next round. It is not
+// a negotiated (PathFinder) routing, as a slot is never shared.
+// With the SMS node order ('opts->NodeOrder'), an II the DFG order fails is
+// mapped again in the order of DFG::getSMSOrderedNodes().
+// With the annealing placer ('opts->Placer'), the II is placed by
+// annealMapAtII() instead of the heuristic.
+bool Mapper::mapAtII(Parameters *params, Options *opts, CGRA* t_cgra,
+    DFG* t_dfg, int t_II, int* t_maxCycle, atomic<int>* t_bestII,
+    map<DFGNode*, CGRANode*>* t_preferred) {
+  m_multicast = opts->Multicast;
+  if (opts->Placer.compare("annealing") == 0 and
+      !params->isStaticElasticCGRA)
+    return annealMapAtII(params, opts, t_cgra, t_dfg, t_II, t_maxCycle,
+                         t_bestII, t_preferred);
+  bool success = false;
+  if (opts->Routing.compare("history") != 0) {
+    success = heuristicMapAtII(params, opts, t_cgra, t_dfg, t_II, t_maxCycle,
+                               t_bestII, t_preferred);
+  } else {
+    t_cgra->clearHistoryCosts();
+    m_rerouting = true;
+    for (int round=0; round<opts->RerouteRounds; ++round) {
+      success = heuristicMapAtII(params, opts, t_cgra, t_dfg, t_II,
+                                 t_maxCycle, t_bestII, t_preferred);
+      // Nothing to reroute around if the node failed for another reason.
+      if (success or m_congestion.empty() or
+          (t_bestII != NULL and *t_bestII <= t_II))
         break;
+      for (pair<CGRALink*, int>& slot: m_congestion)
+        slot.first->addHistoryCost(slot.second);
+    }
+    m_rerouting = false;
+    m_congestion.clear();
+    t_cgra->clearHistoryCosts();
+  }
+  if (!success and opts->NodeOrder.compare("sms") == 0 and
+      (t_bestII == NULL or *t_bestII > t_II)) {
+    t_dfg->getSMSOrderedNodes(&m_nodeOrder);
+    success = heuristicMapAtII(params, opts, t_cgra, t_dfg, t_II, t_maxCycle,
+                               t_bestII, t_preferred);
+    m_nodeOrder.clear();
+  }
+  return success;
+}
+
+// Places the whole DFG onto the MRRG of the given II by simulated
+// annealing, starting from the tiles of 't_preferred' (if any, see
+// getWarmStartPlacement()) and random ones for the other nodes.
+// A state is the tile of every DFG node. The nodes are placed in the DFG
+// order, each one on its own tile at the earliest cycle the router delivers
+// its data at, so the modulo slot follows from the tile. The cost of a
+// state adds up:
+//   - the nodes that do not fit on their tile, as their data cannot be
+//     routed or their recurrences would be broken, weighted to dominate;
+//   - the Manhattan distance between the tiles of the connected nodes, for
+//     the pressure on the links;
+//   - the latest cycle scheduled, for the length of the schedule;
+//   - for every recurrence, the cycles per iteration it takes out of the
+//     ones its distance allows, i.e., the less slack it is left (see
+//     RecurrenceTracker::getSlack()) the more it costs.
+// A move relocates a node onto another tile that supports it or swaps the
+// tiles of two nodes, half of the time around a node that does not fit.
+// Only the nodes from the earliest moved one on are placed again, the
+// others are kept and the rest is taken back via the trail. Gives up after
+// 'opts->AnnealingMoves' moves, or once 't_bestII' (if any) drops to
+// 't_II'. The moves are drawn from a generator seeded with the II, so that
+// mapping the same II again gives the same placement.
+bool Mapper::annealMapAtII(Parameters *params, Options *opts, CGRA* t_cgra,
+    DFG* t_dfg, int t_II, int* t_maxCycle, atomic<int>* t_bestII,
+    map<DFGNode*, CGRANode*>* t_preferred) {
+  const float unplacedCost = 20;
+  const float startTemperature = 10;
+  const float endTemperature = 0.5;
+  vector<DFGNode*> order(t_dfg->nodes.begin(), t_dfg->nodes.end());
+  int nodeCount = order.size();
+  map<DFGNode*, int> position;
+  for (int i=0; i<nodeCount; ++i)
+    position[order[i]] = i;
+  vector<pair<int, int>> edges;
+  for (int i=0; i<nodeCount; ++i) {
+    for (DFGNode* succNode: *(order[i]->getSuccNodes())) {
+      if (position.count(succNode) != 0)
+        edges.push_back(make_pair(i, position[succNode]));
+    }
+  }
+
+  mt19937 generator(t_II);
+  vector<vector<CGRANode*>> candidates(nodeCount);
+  vector<CGRANode*> tiles(nodeCount);
+  for (int i=0; i<nodeCount; ++i) {
+    for (int r=0; r<t_cgra->getRows(); ++r) {
+      for (int c=0; c<t_cgra->getColumns(); ++c) {
+        if (t_cgra->nodes[r][c]->canSupport(order[i]))
+          candidates[i].push_back(t_cgra->nodes[r][c]);
       }
     }
+    if (candidates[i].empty())
+      return false;
+    if (t_preferred != NULL and t_preferred->count(order[i]) != 0 and
+        (*t_preferred)[order[i]]->canSupport(order[i]))
+      tiles[i] = (*t_preferred)[order[i]];
+    else
+      tiles[i] = candidates[i][generator() % candidates[i].size()];
+  }
+
+  constructMRRG(t_dfg, t_cgra, t_II);
+  t_cgra->setTrail(&m_trail);
+  bool quiet = m_quiet;
+  m_quiet = true;
+  vector<int> marks(nodeCount);
+  vector<bool> placed(nodeCount, false);
+  PathArena paths;
+  // Takes back the nodes from 't_first' on and places them again.
+  auto place = [&](int t_first) {
+    for (int i=nodeCount-1; i>=t_first; --i) {
+      if (placed[i])
+        undoSchedule(order[i], marks[i]);
+      placed[i] = false;
+    }
+    for (int i=t_first; i<nodeCount; ++i) {
+      paths.clear();
+      marks[i] = m_trail.mark();
+      if (calculateCost(t_cgra, t_II, order[i], tiles[i], &paths,
+                        false) == -1)
+        continue;
+      int path = getPathWithMinCostAndConstraints(t_cgra, t_II,
+                                                  order[i], &paths);
+      if (path == -1)
+        continue;
+      if (schedule(t_cgra, t_II, order[i], paths.getPath(path),
+                   paths.getPathLength(path),
+                   params->isStaticElasticCGRA) == -1) {
+        undoSchedule(order[i], marks[i]);
+        continue;
+      }
+      placed[i] = true;
+    }
+  };
+  auto cost = [&]() {
+    float total = getMaxCycle();
+    for (int i=0; i<nodeCount; ++i) {
+      if (!placed[i])
+        total += unplacedCost;
+    }
+    for (pair<int, int>& edge: edges) {
+      total += abs(tiles[edge.first]->getX() - tiles[edge.second]->getX()) +
+               abs(tiles[edge.first]->getY() - tiles[edge.second]->getY());
+    }
+    for (int c=0; c<m_recurrences.getCycleCount(); ++c) {
+      int distance = m_recurrences.getDistance(c);
+      total += float(distance * t_II - m_recurrences.getSlack(c)) / distance;
+    }
+    return total;
+  };
+  auto isPlaced = [&]() {
+    return find(placed.begin(), placed.end(), false) == placed.end();
+  };
+
+  place(0);
+  float current = cost();
+  // The nodes from 'stale' on are not placed on their tiles (the move was
+  // rejected after they were placed), they are placed with the next move.
+  int stale = nodeCount;
+  uniform_real_distribution<float> chance(0, 1);
+  vector<int> hot;
+  for (int move=0; move<opts->AnnealingMoves and !isPlaced(); ++move) {
+    if (t_bestII != NULL and *t_bestII <= t_II)
+      break;
+    hot.clear();
+    for (int i=0; i<nodeCount; ++i) {
+      if (placed[i])
+        continue;
+      hot.push_back(i);
+      for (DFGNode* predNode: *(order[i]->getPredNodes())) {
+        if (position.count(predNode) != 0)
+          hot.push_back(position[predNode]);
+      }
+      for (DFGNode* succNode: *(order[i]->getSuccNodes())) {
+        if (position.count(succNode) != 0)
+          hot.push_back(position[succNode]);
+      }
+    }
+    int i = generator() % nodeCount;
+    if (!hot.empty() and generator() % 2 == 0)
+      i = hot[generator() % hot.size()];
+    int j = generator() % nodeCount;
+    CGRANode* tile = tiles[i];
+    if (generator() % 2 == 0 and tiles[j] != tiles[i] and
+        tiles[j]->canSupport(order[i]) and tiles[i]->canSupport(order[j])) {
+      swap(tiles[i], tiles[j]);
+    } else {
+      j = i;
+      tiles[i] = candidates[i][generator() % candidates[i].size()];
+      if (tiles[i] == tile)
+        continue;
+    }
+    int first = min(min(i, j), stale);
+    place(first);
+    float next = cost();
+    float temperature = startTemperature *
+        pow(endTemperature / startTemperature,
+            (float)move / opts->AnnealingMoves);
+    if (next <= current or
+        chance(generator) < exp((current - next) / temperature)) {
+      current = next;
+      stale = nodeCount;
+    } else {
+      if (j != i)
+        swap(tiles[i], tiles[j]);
+      else
+        tiles[i] = tile;
+      stale = first;
+    }
+  }
+  if (stale < nodeCount)
+    place(stale);
+  m_quiet = quiet;
+  t_cgra->setTrail(NULL);
+  m_trail.clear();
+
+  bool success = isPlaced();
+  if (success) {
+    if (getMaxCycle() > *t_maxCycle)
+      *t_maxCycle = getMaxCycle();
+  } else {
+    m_failedDFGNode = order[find(placed.begin(), placed.end(), false) -
+                            placed.begin()];
+  }
+  return success;
+}
+
+// Takes back the placement that blocks the node at 't_position' of
+// 't_order'. The blocker is the 't_depth'-th latest placed node on a tile
+// the node competes for: a tile that supports it, or one next to its mapped
+// neighbours (whose links carry its data). The blocker and everything
+// placed after it are undone, and the blocker is kept off its old tile
+// ('t_avoid') when it is placed again. The node is moved in front of the
+// undone nodes, but stays behind its predecessors. Returns the position to
+// go on mapping from, or -1 if there is no such blocker.
+int Mapper::ripUp(CGRA* t_cgra, vector<DFGNode*>* t_order,
+    vector<int>* t_marks, int t_position, int t_depth,
+    map<DFGNode*, CGRANode*>* t_avoid) {
+  DFGNode* failedDFGNode = (*t_order)[t_position];
+  // A failed schedule() leaves the node partly placed and routed.
+  if (m_mapping.find(failedDFGNode) != m_mapping.end())
+    undoSchedule(failedDFGNode, (*t_marks)[t_position]);
+
+  vector<bool> contested(t_cgra->getFUCount(), false);
+  for (int i=0; i<t_cgra->getRows(); ++i) {
+    for (int j=0; j<t_cgra->getColumns(); ++j) {
+      if (t_cgra->nodes[i][j]->canSupport(failedDFGNode))
+        contested[t_cgra->nodes[i][j]->getID()] = true;
+    }
+  }
+  list<DFGNode*> neighbors(*(failedDFGNode->getPredNodes()));
+  neighbors.insert(neighbors.end(), failedDFGNode->getSuccNodes()->begin(),
+                   failedDFGNode->getSuccNodes()->end());
+  for (DFGNode* neighbor: neighbors) {
+    if (m_mapping.find(neighbor) == m_mapping.end())
+      continue;
+    CGRANode* tile = m_mapping[neighbor];
+    contested[tile->getID()] = true;
+    for (CGRANode* adjacent: *(tile->getNeighbors()))
+      contested[adjacent->getID()] = true;
+  }
+
+  int blocker = -1;
+  int found = 0;
+  for (int k=t_position-1; k>=0; --k) {
+    if (contested[m_mapping[(*t_order)[k]]->getID()] and ++found == t_depth) {
+      blocker = k;
+      break;
+    }
+  }
+  if (blocker == -1)
+    return -1;
+
+  (*t_avoid)[(*t_order)[blocker]] = m_mapping[(*t_order)[blocker]];
+  int front = blocker;
+  for (int k=t_position-1; k>=blocker; --k) {
+    if ((*t_order)[k]->isPredecessorOf(failedDFGNode) and front == blocker)
+      front = k + 1;
+    undoSchedule((*t_order)[k], (*t_marks)[k]);
+  }
+  rotate(t_order->begin() + front, t_order->begin() + t_position,
+         t_order->begin() + t_position + 1);
+  return blocker;
+}
+
+// Keeps the tiles of the failed attempt as the preferred placement of the
+// next II, apart from the node that could not be placed and the nodes it
+// exchanges data with, whose routes are the ones that did not fit.
+void Mapper::getWarmStartPlacement(map<DFGNode*, CGRANode*>* t_preferred) {
+  *t_preferred = m_mapping;
+  if (m_failedDFGNode == NULL)
+    return;
+  t_preferred->erase(m_failedDFGNode);
+  for (DFGNode* predNode: *(m_failedDFGNode->getPredNodes()))
+    t_preferred->erase(predNode);
+  for (DFGNode* succNode: *(m_failedDFGNode->getSuccNodes()))
+    t_preferred->erase(succNode);
+}
+
+MapResult *Mapper::heuristicMap(Parameters *params, Options *opts, CGRA* t_cgra, DFG* t_dfg, int t_II) {
+  if (opts->MapThreads > 1 and !params->isStaticElasticCGRA)
+    return parallelHeuristicMap(params, opts, t_cgra, t_dfg, t_II);
+
+  bool fail = false;
+  int max_cycle = 0;
+  map<DFGNode*, CGRANode*> preferred;
+  while (1) {
+    fail = !mapAtII(params, opts, t_cgra, t_dfg, t_II, &max_cycle, NULL,
+                    opts->WarmStart ? &preferred : NULL);
     if (!fail)
       break;
     else if (params->isStaticElasticCGRA) {
@@ -1305,6 +1664,8 @@ int max_cycle = 0;
 
 		break;
 	}
+    if (opts->WarmStart)
+      getWarmStartPlacement(&preferred);
     ++t_II;
   }
 
@@ -1312,128 +1673,165 @@ int max_cycle = 0;
   return result;
 }
 
+// Tries 'opts->MapThreads' II values at a time, each on its own mapper and
+// CGRA. The II values are handed out in increasing order, and an attempt
+// is dropped once a smaller II succeeds, so the result is the one of the
+// serial scan in heuristicMap(): the smallest feasible II, with the max
+// cycle accumulated over the attempts up to it. The winning II is mapped
+// again on this mapper and 't_cgra' to keep the schedule for the reports,
+// the max cycle of that II is the one of the replay.
+MapResult* Mapper::parallelHeuristicMap(Parameters *params, Options *opts,
+    CGRA* t_cgra, DFG* t_dfg, int t_II) {
+  int lastII = t_II > opts->MaxII ? t_II : opts->MaxII + 1;
+  int attemptCount = lastII - t_II + 1;
+  int threadCount = opts->MapThreads;
+  if (threadCount > attemptCount)
+    threadCount = attemptCount;
+
+  // The predecessors/successors of the DFG nodes are cached lazily, make
+  // sure they are built before the DFG is shared by the workers.
+  for (DFGNode* dfgNode: t_dfg->nodes) {
+    dfgNode->getPredNodes();
+    dfgNode->getSuccNodes();
+  }
+  vector<CGRA*> cgras;
+  for (int i=0; i<threadCount; ++i)
+    cgras.push_back(t_cgra->clone());
+
+  atomic<int> nextII(t_II);
+  atomic<int> bestII(lastII + 1);
+  vector<int> maxCycles(attemptCount, 0);
+  vector<thread> workers;
+  for (int i=0; i<threadCount; ++i) {
+    workers.push_back(thread([&, i]() {
+      // The workers share the output streams, only the replay below prints.
+      Mapper mapper;
+      mapper.m_quiet = true;
+      while (1) {
+        int II = nextII++;
+        if (II > lastII or II >= bestII)
+          break;
+        bool success = mapper.mapAtII(params, opts, cgras[i], t_dfg, II,
+            &maxCycles[II - t_II], &bestII, NULL);
+        int best = bestII;
+        while (success and II < best and
+               !bestII.compare_exchange_weak(best, II));
+      }
+    }));
+  }
+  for (thread& worker: workers)
+    worker.join();
+
+  bool fail = bestII > lastII;
+  int II = fail ? lastII : bestII.load();
+  // The replay is not assumed to map the II again, if it fails the II is
+  // raised as in heuristicMap() so that the result describes the schedule
+  // kept on 't_cgra'.
+  while (!fail) {
+    int cycle = 0;
+    bool success = mapAtII(params, opts, t_cgra, t_dfg, II, &cycle, NULL,
+                           NULL);
+    maxCycles[II - t_II] = success ? cycle :
+        max(maxCycles[II - t_II], cycle);
+    if (success)
+      break;
+    if (II == lastII)
+      fail = true;
+    else
+      ++II;
+  }
+  int max_cycle = 0;
+  for (int i=t_II; i<=II; ++i) {
+    if (maxCycles[i - t_II] > max_cycle)
+      max_cycle = maxCycles[i - t_II];
+  }
+  return new MapResult(fail, II, max_cycle, t_dfg);
+}
+
 MapResult *Mapper::exhaustiveMap(CGRA* t_cgra, DFG* t_dfg, int t_II,
     bool t_isStaticElasticCGRA, bool PrintMappingFailures) {
-  list<map<CGRANode*, int>*>* exhaustivePaths = new list<map<CGRANode*, int>*>();
   list<DFGNode*>* mappedDFGNodes = new list<DFGNode*>();
+  // The MRRG is built once, the search backtracks by undoing the updates
+  // recorded in the trail.
+  constructMRRG(t_dfg, t_cgra, t_II);
+  t_cgra->setTrail(&m_trail);
   bool success = DFSMap(t_cgra, t_dfg, t_II, mappedDFGNodes,
-      exhaustivePaths, t_isStaticElasticCGRA, PrintMappingFailures);
+      t_isStaticElasticCGRA, PrintMappingFailures);
+  t_cgra->setTrail(NULL);
+  m_trail.clear();
+  delete mappedDFGNodes;
   if (success)
     return new MapResult(true, t_II, t_II, t_dfg); // TODO --- properly get max cycle.
   else
     return new MapResult(false, -1, -1, t_dfg);
 }
 
+// Maps the DFG nodes in order, on top of the placement and routing of the
+// already mapped ones ('t_mappedDFGNodes'). A candidate path that fails
+// (now or deeper in the search) is taken back via the trail, the MRRG is
+// neither rebuilt nor replayed.
 bool Mapper::DFSMap(CGRA* t_cgra, DFG* t_dfg, int t_II,
     list<DFGNode*>* t_mappedDFGNodes,
-    list<map<CGRANode*, int>*>* t_exhaustivePaths,
     bool t_isStaticElasticCGRA, bool PrintMappingFailures) {
-//  , DFGNode* t_badMappedDFGNode) {
-
-//  list<map<CGRANode*, int>*>* exhaustivePaths = t_exhaustivePaths;
-
-  constructMRRG(t_dfg, t_cgra, t_II);
-
-//  list<DFGNode*> dfgNodeSearchPool;
-//  for (list<DFGNode*>::iterator dfgNodeItr=dfg->nodes.begin();
-//      dfgNodeItr!=dfg->nodes.end(); ++dfgNodeItr) {
-//    dfgNodeSearchPool.push_back(*dfgNodeItr);
-//  }
-
-  list<DFGNode*>::iterator mappedDFGNodeItr = t_mappedDFGNodes->begin();
   list<DFGNode*>::iterator dfgNodeItr = t_dfg->nodes.begin();
-//  list<DFGNode*>::iterator dfgNodeItr = t_dfg->getDFSOrderedNodes()->begin();
-//  errs()<<"----copying previous schedule in exhaustive----\n";
-  for (map<CGRANode*, int>* path: *t_exhaustivePaths) {
-//    errs()<<"----copying previous schedule in exhaustive---- targetDFGNode: "<<(*mappedDFGNodeItr)->getID()<<"\n";
-  int scheduled_cycle = schedule(t_cgra, t_dfg, t_II, *mappedDFGNodeItr, path, t_isStaticElasticCGRA);
-    if (scheduled_cycle < 0) {
-      cout<<"DEBUG <this is impossible> fail3 in DFS() II: "<<t_II<<"\n";
-      assert(0);
-      break;
-    }
-    ++mappedDFGNodeItr;
-//    dfgNodeSearchPool.remove(*dfgNodeItr);
-    ++dfgNodeItr;
-  }
-//  if (dfgNodeSearchPool.size() == 0) {
+  advance(dfgNodeItr, t_mappedDFGNodes->size());
   if (dfgNodeItr == t_dfg->nodes.end())
     return true;
-//  }
 
   DFGNode* targetDFGNode = *dfgNodeItr;
 
-//  errs()<<"DEBUG just now finished the previous path copying...\n";
-//  for (list<DFGNode*>::iterator dfgNodeItr=dfgNodeSearchPool.begin();
-//      dfgNodeItr!=dfgNodeSearchPool.end(); ++dfgNodeItr) {
-  list<map<CGRANode*, int>*> paths;
+  // The candidates of this level stay alive while the deeper levels are
+  // searched, so every level has its own arena.
+  PathArena paths;
   for (int i=0; i<t_cgra->getRows(); ++i) {
     for (int j=0; j<t_cgra->getColumns(); ++j) {
       CGRANode* fu = t_cgra->nodes[i][j];
-      map<CGRANode*, int>* tempPath =
-          calculateCost(t_cgra, t_dfg, t_II, targetDFGNode, fu, PrintMappingFailures);
-      if(tempPath != NULL and tempPath->size() != 0) {
-        paths.push_back(tempPath);
-      }
+      calculateCost(t_cgra, t_II, targetDFGNode, fu, &paths,
+                    PrintMappingFailures);
     }
   }
 
-  list<map<CGRANode*, int>*>* potentialPaths =
-      getOrderedPotentialPaths(t_cgra, t_dfg, t_II, targetDFGNode, &paths);
+  vector<int> potentialPaths;
+  getOrderedPotentialPaths(t_cgra, t_II, targetDFGNode, &paths,
+                           &potentialPaths);
   bool success = false;
 //  errs()<<"----try to schedule in exhaustive---- targetDFGNode: "<<targetDFGNode->getID()<<"\n";
-  while (potentialPaths->size() != 0) {
-    map<CGRANode*, int>* currentPath = potentialPaths->front();
-    potentialPaths->pop_front();
-    assert(currentPath->size() != 0);
-//    errs()<<"----try to schedule in exhaustive---- targetDFGNode: "<<targetDFGNode->getID()<<"\n";
-    if (schedule(t_cgra, t_dfg, t_II, targetDFGNode, currentPath,
+  for (int currentPath: potentialPaths) {
+    int mark = m_trail.mark();
+    if (schedule(t_cgra, t_II, targetDFGNode,
+        paths.getPath(currentPath), paths.getPathLength(currentPath),
         t_isStaticElasticCGRA) != -1) {
-      t_exhaustivePaths->push_back(currentPath);
       t_mappedDFGNodes->push_back(targetDFGNode);
 //      errs()<<"--- success in mapping target DFG node: "<<targetDFGNode->getID()<<"\n";
       success = DFSMap(t_cgra, t_dfg, t_II, t_mappedDFGNodes,
-          t_exhaustivePaths, t_isStaticElasticCGRA, PrintMappingFailures);
+          t_isStaticElasticCGRA, PrintMappingFailures);
       if (success)
         return true;
     }
-    // If the schedule fails and need to try the other schedule,
-    // should re-construct m_mapping and m_mappingTiming.
-    constructMRRG(t_dfg, t_cgra, t_II);
-    list<DFGNode*>::iterator mappedDFGNodeItr = t_mappedDFGNodes->begin();
-//    errs()<<"-- second copying previous schedule in while --\n";
-    for (map<CGRANode*, int>* path: *t_exhaustivePaths) {
-      if (schedule(t_cgra, t_dfg, t_II, *mappedDFGNodeItr, path,
-          t_isStaticElasticCGRA) == -1) {
-        cout<<"DEBUG <this is impossible> fail7 in DFS() II: "<<t_II<<"\n";
-        assert(0);
-        break;
-      }
-      ++mappedDFGNodeItr;
-    }
+    // If the schedule fails and need to try the other schedule, take back
+    // the placement and the routing of this candidate.
+    undoSchedule(targetDFGNode, mark);
   }
-  if (t_exhaustivePaths->size() != 0) {
-    cout<<"======= go backward one step ======== popped DFG node ["<<t_mappedDFGNodes->back()->getID()<<"] from CGRA node ["<<m_mapping[t_mappedDFGNodes->back()]->getID()<<"]\n";
+  if (t_mappedDFGNodes->size() != 0) {
+    if (!m_quiet)
+      cout<<"======= go backward one step ======== popped DFG node ["<<t_mappedDFGNodes->back()->getID()<<"] from CGRA node ["<<m_mapping[t_mappedDFGNodes->back()]->getID()<<"]\n";
     t_mappedDFGNodes->pop_back();
-    t_exhaustivePaths->pop_back();
-//    m_exit++;
-//    if (m_exit == 2)
-//      exit(0);
   }
-  delete potentialPaths;
   return false;
 }
 
-// This helper function assume the cycle for each mapped CGRANode increases
-// gradually along the path. Otherwise, the map struct will get conflict key.
-map<int, CGRANode*>* Mapper::getReorderPath(map<CGRANode*, int>* t_path) {
-  map<int, CGRANode*>* reorderPath = new map<int, CGRANode*>();
-  for (map<CGRANode*, int>::iterator iter=t_path->begin();
-      iter!=t_path->end(); ++iter) {
-    assert(reorderPath->find((*iter).second) == reorderPath->end());
-    (*reorderPath)[(*iter).second] = (*iter).first;
+// Restores the MRRG to the trail 't_mark' (taken before 't_dfgNode' was
+// scheduled).
+void Mapper::undoSchedule(DFGNode* t_dfgNode, int t_mark) {
+  m_trail.undo(t_mark);
+  map<DFGNode*, CGRANode*>::iterator placement = m_mapping.find(t_dfgNode);
+  if (placement != m_mapping.end()) {
+    m_tileNodes[placement->second->getID()].remove(t_dfgNode);
+    m_mapping.erase(placement);
   }
-  assert(reorderPath->size() == t_path->size());
-  return reorderPath;
+  m_mappingTiming.erase(t_dfgNode);
+  m_recurrences.unschedule(t_dfgNode);
+  t_dfgNode->clearMapped();
+  // The routing trees are no longer valid once the MRRG is updated.
+  clearRoutingTrees();
 }
-
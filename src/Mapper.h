@@ -8,39 +8,94 @@
  *   Date : July 16, 2019
  */
 
+#ifndef Mapper_H
+#define Mapper_H
+
 #include "DFG.h"
 #include "CGRA.h"
 #include "MapResult.h"
 #include "Options.h"
+#include "Router.h"
+#include "MappingTrail.h"
+#include "PathArena.h"
+#include "RecurrenceTracker.h"
+#include <atomic>
 
 class Mapper {
   private:
     int m_maxMappingCycle;
     map<DFGNode*, CGRANode*> m_mapping;
     map<DFGNode*, int> m_mappingTiming;
-    map<CGRANode*, int>* dijkstra_search(CGRA*, DFG*, int, DFGNode*,
-                                         DFGNode*, CGRANode*);
+    // The DFG nodes placed on each tile (indexed by the tile ID), kept in
+    // step with 'm_mapping' by schedule() and undoSchedule().
+    vector<list<DFGNode*>> m_tileNodes;
+    list<DFGNode*>* getMappedDFGNodes(CGRANode*);
+    // The node the latest heuristic attempt failed on, if any.
+    DFGNode* m_failedDFGNode;
+    // The link slots the routing of the node being mapped could not take,
+    // logged while the history rerouting is on (see mapAtII()).
+    vector<pair<CGRALink*, int>> m_congestion;
+    bool m_rerouting;
+    // The routes of a value are joined into a multicast tree (see
+    // Router::setMulticast()).
+    bool m_multicast;
+    // The order the heuristic maps the nodes in, if not the DFG order.
+    list<DFGNode*> m_nodeOrder;
+    // Nothing is printed while the mapping runs: the failed placements are
+    // part of the annealing, and the workers of parallelHeuristicMap() share
+    // the output streams.
+    bool m_quiet;
+    Router* m_router;
+    MappingTrail m_trail;
+    RecurrenceTracker m_recurrences;
+    map<DFGNode*, Router*> m_routingTrees;
+    vector<PathStep> m_searchPath;
+    vector<PathStep> m_latestPath;
+    vector<float> m_pathCosts;
+    Router* getRoutingTree(CGRA*, int, DFGNode*);
+    void clearRoutingTrees();
+    bool dijkstra_search(CGRA*, int, DFGNode*, DFGNode*, CGRANode*,
+                         vector<PathStep>*);
     int getMaxMappingCycle();
-    bool tryToRoute(CGRA*, DFG*, int, DFGNode*, CGRANode*,
+    bool tryToRoute(CGRA*, int, DFGNode*, CGRANode*,
                     DFGNode*, CGRANode*, int, bool, bool);
-    list<DFGNode*>* getMappedDFGNodes(DFG*, CGRANode*);
-    map<int, CGRANode*>* getReorderPath(map<CGRANode*, int>*);
-    bool DFSMap(CGRA*, DFG*, int, list<DFGNode*>*, list<map<CGRANode*, int>*>*, bool, bool);
-    list<map<CGRANode*, int>*>* getOrderedPotentialPaths(CGRA*, DFG*, int,
-        DFGNode*, list<map<CGRANode*, int>*>*);
+    bool DFSMap(CGRA*, DFG*, int, list<DFGNode*>*, bool, bool);
+    void undoSchedule(DFGNode*, int);
+    float getPathCost(CGRA*, int, DFGNode*, PathStep*, int);
+    void getOrderedPotentialPaths(CGRA*, int, DFGNode*, PathArena*,
+                                  vector<int>*);
+    bool heuristicMapAtII(Parameters*, Options*, CGRA*, DFG*, int, int*,
+                          atomic<int>*, map<DFGNode*, CGRANode*>*);
+    bool mapAtII(Parameters*, Options*, CGRA*, DFG*, int, int*,
+                 atomic<int>*, map<DFGNode*, CGRANode*>*);
+    bool annealMapAtII(Parameters*, Options*, CGRA*, DFG*, int, int*,
+                       atomic<int>*, map<DFGNode*, CGRANode*>*);
+    void getWarmStartPlacement(map<DFGNode*, CGRANode*>*);
+    int ripUp(CGRA*, vector<DFGNode*>*, vector<int>*, int, int,
+              map<DFGNode*, CGRANode*>*);
+    MapResult* parallelHeuristicMap(Parameters*, Options*, CGRA*, DFG*, int);
 
   public:
-    Mapper(){}
+    Mapper(){
+      m_router = NULL;
+      m_failedDFGNode = NULL;
+      m_rerouting = false;
+      m_multicast = false;
+      m_quiet = false;
+    }
+    ~Mapper();
     int getResMII(DFG*, CGRA*);
     int getRecMII(DFG*);
 	int getMaxCycle();
     void constructMRRG(DFG*, CGRA*, int);
     MapResult *heuristicMap(Parameters *, Options*, CGRA*, DFG*, int);
     MapResult *exhaustiveMap(CGRA*, DFG*, int, bool, bool);
-    map<CGRANode*, int>* calculateCost(CGRA*, DFG*, int, DFGNode*, CGRANode*, bool PrintMappingFailures);
-    map<CGRANode*, int>* getPathWithMinCostAndConstraints(CGRA*, DFG*, int,
-        DFGNode*, list<map<CGRANode*, int>*>*);
-    int schedule(CGRA*, DFG*, int, DFGNode*, map<CGRANode*, int>*, bool);
+    int calculateCost(CGRA*, int, DFGNode*, CGRANode*, PathArena*,
+                      bool PrintMappingFailures);
+    int getPathWithMinCostAndConstraints(CGRA*, int, DFGNode*, PathArena*);
+    int schedule(CGRA*, int, DFGNode*, PathStep*, int, bool);
     void showSchedule(CGRA*, DFG*, MapResult*, bool);
-    void generateJSON(CGRA*, DFG*, MapResult*, bool);
+    void generateJSON(CGRA*, MapResult*, bool);
 };
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * ======================================================================
+ * MappingContext.cpp
+ * ======================================================================
+ * Self-contained state of a mapping.
+ */
+
+#include "MappingContext.h"
+
+MappingContext::MappingContext(Options* t_options, Parameters* t_params):
+    m_options(*t_options), m_params(*t_params) {
+  m_cgra = m_params.getCGRA(&m_options);
+  m_cgra->setRegConstraint(m_params.regConstraint);
+  m_cgra->setCtrlMemConstraint(m_params.ctrlMemConstraint);
+  m_cgra->setBypassConstraint(m_params.bypassConstraint);
+  m_mapper = new Mapper();
+}
+
+// The CGRA is cloned rather than built from the parameters again, the MRRG
+// of the clone is empty.
+MappingContext::MappingContext(MappingContext* t_context):
+    m_options(t_context->m_options), m_params(t_context->m_params) {
+  m_cgra = t_context->m_cgra->clone(&m_options, &m_params);
+  m_mapper = new Mapper();
+}
+
+MappingContext::~MappingContext() {
+  delete m_mapper;
+  delete m_cgra;
+}
+
+MappingContext* MappingContext::clone() {
+  return new MappingContext(this);
+}
+
+Options* MappingContext::getOptions() {
+  return &m_options;
+}
+
+Parameters* MappingContext::getParameters() {
+  return &m_params;
+}
+
+CGRA* MappingContext::getCGRA() {
+  return m_cgra;
+}
+
+Mapper* MappingContext::getMapper() {
+  return m_mapper;
+}
@@ -0,0 +1,38 @@
+/*
+ * ======================================================================
+ * MappingContext.h
+ * ======================================================================
+ * Self-contained state of a mapping header file.
+ */
+
+#ifndef MappingContext_H
+#define MappingContext_H
+
+#include "CGRA.h"
+#include "Mapper.h"
+#include "Options.h"
+
+// Owns everything a mapping reads or writes: its own copies of the options
+// and the parameters, the CGRA (holding the MRRG) and the mapper. Contexts
+// do not share any mutable state, so mappings in different contexts can
+// run concurrently in the same process. The parameter tables loaded from
+// the json file (opmap, additionalFunc, ...) are only read, and are shared.
+class MappingContext {
+  private:
+    Options m_options;
+    Parameters m_params;
+    CGRA* m_cgra;
+    Mapper* m_mapper;
+    MappingContext(MappingContext*);
+
+  public:
+    MappingContext(Options*, Parameters*);
+    ~MappingContext();
+    MappingContext* clone();
+    Options* getOptions();
+    Parameters* getParameters();
+    CGRA* getCGRA();
+    Mapper* getMapper();
+};
+
+#endif
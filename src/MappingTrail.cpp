@@ -0,0 +1,61 @@
+/*
+ * ======================================================================
+ * MappingTrail.cpp
+ * ======================================================================
+ * Undo log of the MRRG updates.
+ */
+
+#include "MappingTrail.h"
+#include "CGRANode.h"
+
+#define TRAIL_INT       0 // An int field is overwritten
+#define TRAIL_WORD      1 // A word of a SlotBitset is overwritten
+#define TRAIL_POINTER   2 // A DFG node slot is overwritten
+#define TRAIL_PUSH_BACK 3 // An entry is appended to a reservation list
+
+int MappingTrail::mark() {
+  return m_entries.size();
+}
+
+// Takes back all the updates recorded after 't_mark'.
+void MappingTrail::undo(int t_mark) {
+  while ((int)m_entries.size() > t_mark) {
+    Entry& entry = m_entries.back();
+    switch (entry.kind) {
+      case TRAIL_INT:
+        *(int*)entry.address = (int)entry.value;
+        break;
+      case TRAIL_WORD:
+        *(uint64_t*)entry.address = entry.value;
+        break;
+      case TRAIL_POINTER:
+        *(DFGNode**)entry.address = (DFGNode*)(uintptr_t)entry.value;
+        break;
+      case TRAIL_PUSH_BACK:
+        ((list<FUOccupancy>*)entry.address)->pop_back();
+        break;
+    }
+    m_entries.pop_back();
+  }
+}
+
+// Forgets the recorded updates, e.g., once the MRRG is rebuilt.
+void MappingTrail::clear() {
+  m_entries.clear();
+}
+
+void MappingTrail::saveInt(int* t_field) {
+  m_entries.push_back({TRAIL_INT, t_field, (uint64_t)*t_field});
+}
+
+void MappingTrail::saveWord(uint64_t* t_word) {
+  m_entries.push_back({TRAIL_WORD, t_word, *t_word});
+}
+
+void MappingTrail::savePointer(DFGNode** t_slot) {
+  m_entries.push_back({TRAIL_POINTER, t_slot, (uint64_t)(uintptr_t)*t_slot});
+}
+
+void MappingTrail::savePushBack(list<FUOccupancy>* t_list) {
+  m_entries.push_back({TRAIL_PUSH_BACK, t_list, 0});
+}
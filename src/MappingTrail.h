@@ -0,0 +1,44 @@
+/*
+ * ======================================================================
+ * MappingTrail.h
+ * ======================================================================
+ * Undo log of the MRRG updates header file.
+ */
+
+#ifndef MappingTrail_H
+#define MappingTrail_H
+
+#include <stdint.h>
+#include <list>
+#include <vector>
+
+using namespace std;
+
+class DFGNode;
+struct FUOccupancy;
+
+// Records the old value of every MRRG field that is overwritten while the
+// trail is attached to the CGRA (see CGRA::setTrail()). Undoing back to a
+// mark restores the fields in reverse order, so a backtrack costs as much
+// as the placement and routing that are taken back, rather than a rebuild
+// and replay of the whole MRRG.
+class MappingTrail {
+  private:
+    struct Entry {
+      int kind;
+      void* address;
+      uint64_t value;
+    };
+    vector<Entry> m_entries;
+
+  public:
+    int mark();
+    void undo(int);
+    void clear();
+    void saveInt(int*);
+    void saveWord(uint64_t*);
+    void savePointer(DFGNode**);
+    void savePushBack(list<FUOccupancy>*);
+};
+
+#endif
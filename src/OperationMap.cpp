@@ -1,4 +1,42 @@
 #include<string>
+#include<mutex>
+#include<unordered_map>
 #include "OperationMap.h"
 
+// The DFG and the tiles of the concurrent mappings intern their opcodes
+// through the same table.
+static std::mutex operationIDLock;
+static std::unordered_map<std::string, OperationID> operationIDs;
 
+OperationID getOperationID(const OperationNumber& t_operation) {
+  std::lock_guard<std::mutex> guard(operationIDLock);
+  auto it = operationIDs.find(t_operation);
+  if (it != operationIDs.end()) {
+    return it->second;
+  }
+  OperationID id = operationIDs.size();
+  operationIDs[t_operation] = id;
+  return id;
+}
+
+void OperationSet::add(OperationID t_id) {
+  unsigned word = t_id / 64;
+  if (word >= m_words.size()) {
+    m_words.resize(word + 1, 0);
+  }
+  m_words[word] |= (uint64_t)1 << (t_id % 64);
+}
+
+void OperationSet::add(std::list<OperationNumber>* t_operations) {
+  for (OperationNumber& operation: *t_operations) {
+    add(getOperationID(operation));
+  }
+}
+
+bool OperationSet::contains(OperationID t_id) {
+  unsigned word = t_id / 64;
+  if (word >= m_words.size()) {
+    return false;
+  }
+  return (m_words[word] >> (t_id % 64)) & 1;
+}
@@ -1,6 +1,12 @@
+#ifndef OperationMap_H
+#define OperationMap_H
+
 #include <iostream>
 #include <stdio.h>
 #include <string>
+#include <list>
+#include <vector>
+#include <stdint.h>
 
 #define OperationNumber std::string
 
@@ -17,3 +23,23 @@
 /* 	FloatMul, */
 /* 	MemoryOp */
 /* }; */
+
+// The opcode names are interned into dense IDs the first time they are seen
+// (while building the DFG and the tiles), so the checks done during the
+// placement only compare integers. The IDs are stable for the whole run.
+typedef int OperationID;
+
+OperationID getOperationID(const OperationNumber&);
+
+// The set of operations a tile supports, one bit per interned opcode.
+class OperationSet {
+  private:
+    std::vector<uint64_t> m_words;
+
+  public:
+    void add(OperationID);
+    void add(std::list<OperationNumber>*);
+    bool contains(OperationID);
+};
+
+#endif
@@ -46,6 +46,15 @@ cl::opt<bool> LLVMDebugOperationMap ("debug-operation-map", cl::desc("Debug the
 cl::opt<bool> PrintOperationCount("print-operation-count", cl::desc("Print the operation counts in the DFG for debugging rewrite rules"));
 cl::opt<bool> PrintUsedRules("print-used-rules", cl::desc("Print the number of used rules"));
 cl::opt<int> MaxII("max-ii", cl::desc("Max II to scan up to"), cl::init(50));
+cl::opt<int> MapThreads("map-threads", cl::desc("Number of II values tried concurrently by the heuristic mapping (1 tries them one after another)"), cl::init(1));
+cl::opt<std::string> Routing("routing", cl::desc("Routing of the heuristic mapping.  Options are: greedy, history (the failed II is rerouted with a history cost on the link slots it could not get)."), cl::init("greedy"));
+cl::opt<int> RerouteRounds("reroute-rounds", cl::desc("Max number of rerouting rounds of the history routing for each II"), cl::init(10));
+cl::opt<bool> Multicast("multicast", cl::desc("Route the consumers of a value as a multicast tree, sharing the link slots that already carry it"));
+cl::opt<std::string> Placer("placer", cl::desc("Placement of the DFG nodes at each II.  Options are: heuristic, annealing (simulated annealing instead of the heuristic, started from the placement of the failed II with -warm-start)."), cl::init("heuristic"));
+cl::opt<int> AnnealingMoves("annealing-moves", cl::desc("Max number of moves of the annealing placer for each II"), cl::init(2000));
+cl::opt<std::string> NodeOrder("node-order", cl::desc("Order the DFG nodes are mapped in.  Options are: sms (the II values the DFG order fails are mapped again in a swing modulo scheduling style order), dfg (only the order the DFG is built in)."), cl::init("sms"));
+cl::opt<int> RepairBudget("repair-budget", cl::desc("Number of times the heuristic mapping of an II rips up the placement blocking a node before giving up on the II"), cl::init(0));
+cl::opt<bool> WarmStart("warm-start", cl::desc("Start the mapping of the next II (heuristic or annealing) from the placement of the failed one (only when the II values are tried one after another)"));
 
 cl::opt<std::string> Params("params-file", cl::desc("Json file with the CGRA parameters"));
 cl::list<std::string> RulesetsOpt("ruleset", cl::desc("Rulesets to use: valid options are: int, fp, boolean, stochastic, gcc (default is gcc, gcc = int ruleset + fp ruleset)"));
@@ -78,6 +87,15 @@ TCLAP::CmdLine cmd("Tool to schedule a DFG Json file onto a CGRA");
   TCLAP::SwitchArg debug_mapping_loop("", "debug-mapping-loop", "Debug the mapping loop", cmd, false);
   TCLAP::SwitchArg print_mapping_failures("", "print-mapping-failures", "Debugg mapping failures", cmd, false);
   TCLAP::SwitchArg skip_build("", "skip-build", "only do dump", cmd, false);
+  TCLAP::ValueArg<int> map_threads("", "map-threads", "Number of II values tried concurrently by the heuristic mapping", false, 1, "int", cmd);
+  TCLAP::ValueArg<std::string> routing("", "routing", "Routing of the heuristic mapping: greedy or history", false, "greedy", "string", cmd);
+  TCLAP::ValueArg<int> reroute_rounds("", "reroute-rounds", "Max number of rerouting rounds of the history routing for each II", false, 10, "int", cmd);
+  TCLAP::SwitchArg multicast("", "multicast", "Route the consumers of a value as a multicast tree, sharing the link slots that already carry it", cmd, false);
+  TCLAP::ValueArg<std::string> placer("", "placer", "Placement of the DFG nodes at each II: heuristic or annealing", false, "heuristic", "string", cmd);
+  TCLAP::ValueArg<int> annealing_moves("", "annealing-moves", "Max number of moves of the annealing placer for each II", false, 2000, "int", cmd);
+  TCLAP::ValueArg<std::string> node_order("", "node-order", "Order the DFG nodes are mapped in: sms (the II values the DFG order fails are mapped again in a swing modulo scheduling style order) or dfg", false, "sms", "string", cmd);
+  TCLAP::ValueArg<int> repair_budget("", "repair-budget", "Number of times the heuristic mapping of an II rips up the placement blocking a node before giving up on the II", false, 0, "int", cmd);
+  TCLAP::SwitchArg warm_start("", "warm-start", "Start the mapping of the next II from the placement of the failed one", cmd, false);
 
   TCLAP::MultiArg<std::string> trulesets("s", "ruleset", "Rulesets (valid sets are int, fp, boolean, gcc (gcc = int + fp).  Default is gcc", false, "ruleset", cmd);
 
@@ -110,6 +128,24 @@ TCLAP::CmdLine cmd("Tool to schedule a DFG Json file onto a CGRA");
   opt->PrintOperationCount = false;
   opt->PrintUsedRules = false;
   opt->MaxII = 50;
+  opt->MapThreads = map_threads.getValue();
+  opt->WarmStart = warm_start;
+  opt->RepairBudget = repair_budget.getValue();
+  opt->Routing = routing.getValue();
+  opt->RerouteRounds = reroute_rounds.getValue();
+  opt->Multicast = multicast;
+  opt->Placer = placer.getValue();
+  opt->AnnealingMoves = annealing_moves.getValue();
+  opt->NodeOrder = node_order.getValue();
+  if (opt->Routing.compare("greedy") && opt->Routing.compare("history")) {
+    throw invalid_argument("Invalid routing " + opt->Routing);
+  }
+  if (opt->Placer.compare("heuristic") && opt->Placer.compare("annealing")) {
+    throw invalid_argument("Invalid placer " + opt->Placer);
+  }
+  if (opt->NodeOrder.compare("sms") && opt->NodeOrder.compare("dfg")) {
+    throw invalid_argument("Invalid node order " + opt->NodeOrder);
+  }
 
   opt->Params = cgra.getValue();
   opt->rulesets = list<std::string>();
@@ -186,6 +222,15 @@ Options *setupOptions() {
   opt->PrintUsedRules = PrintUsedRules;
 
   opt->MaxII = MaxII;
+  opt->MapThreads = MapThreads;
+  opt->WarmStart = WarmStart;
+  opt->RepairBudget = RepairBudget;
+  opt->Routing = Routing;
+  opt->RerouteRounds = RerouteRounds;
+  opt->Multicast = Multicast;
+  opt->Placer = Placer;
+  opt->AnnealingMoves = AnnealingMoves;
+  opt->NodeOrder = NodeOrder;
 
 	opt->Params = Params;
   opt->rulesets = list<std::string>();
@@ -194,6 +239,15 @@ Options *setupOptions() {
   if (opt->EGraphMode.compare("binary") && opt->EGraphMode.compare("frequency")) {
 	  throw invalid_argument("Invlaid mode " + opt->EGraphMode);
   }
+  if (opt->Routing.compare("greedy") && opt->Routing.compare("history")) {
+	  throw invalid_argument("Invalid routing " + opt->Routing);
+  }
+  if (opt->Placer.compare("heuristic") && opt->Placer.compare("annealing")) {
+	  throw invalid_argument("Invalid placer " + opt->Placer);
+  }
+  if (opt->NodeOrder.compare("sms") && opt->NodeOrder.compare("dfg")) {
+	  throw invalid_argument("Invalid node order " + opt->NodeOrder);
+  }
   for (std::string rnam : RulesetsOpt) {
     if (!rnam.compare("gcc")) {
       opt->rulesets.push_back("fp");
@@ -40,6 +40,15 @@ class Options {
 		bool PrintUsedRules;
 
 		int MaxII;
+		int MapThreads;
+		bool WarmStart;
+		int RepairBudget;
+		std::string Routing;
+		int RerouteRounds;
+		bool Multicast;
+		std::string Placer;
+		int AnnealingMoves;
+		std::string NodeOrder;
 
 		std::string Params;
 		list<std::string> rulesets;
@@ -0,0 +1,41 @@
+/*
+ * ======================================================================
+ * PathArena.cpp
+ * ======================================================================
+ * Storage of the candidate paths.
+ */
+
+#include "PathArena.h"
+
+PathArena::PathArena() {
+  m_offsets.push_back(0);
+}
+
+void PathArena::clear() {
+  m_steps.clear();
+  m_offsets.resize(1);
+}
+
+int PathArena::getPathCount() {
+  return m_offsets.size() - 1;
+}
+
+// Copies the steps of 't_path' into the arena and returns the path index.
+int PathArena::addPath(vector<PathStep>* t_path) {
+  m_steps.insert(m_steps.end(), t_path->begin(), t_path->end());
+  m_offsets.push_back(m_steps.size());
+  return m_offsets.size() - 2;
+}
+
+// The steps are only valid until the next path is added.
+PathStep* PathArena::getPath(int t_path) {
+  return &m_steps[m_offsets[t_path]];
+}
+
+int PathArena::getPathLength(int t_path) {
+  return m_offsets[t_path + 1] - m_offsets[t_path];
+}
+
+PathStep* PathArena::getTarget(int t_path) {
+  return &m_steps[m_offsets[t_path + 1] - 1];
+}
@@ -0,0 +1,43 @@
+/*
+ * ======================================================================
+ * PathArena.h
+ * ======================================================================
+ * Storage of the candidate paths header file.
+ */
+
+#ifndef PathArena_H
+#define PathArena_H
+
+#include <vector>
+
+using namespace std;
+
+class CGRANode;
+
+// One tile the data goes through, with the cycle it is reached at.
+struct PathStep {
+  int cycle;
+  CGRANode* tile;
+};
+
+// The candidate paths of the DFG node that is being mapped. A path is a
+// run of steps ordered by cycle, the last one being the tile the DFG node
+// is placed on. The paths are stored back to back in a single buffer that
+// is cleared (keeping its capacity) before the next DFG node, so building
+// the candidates does not allocate once the buffer has grown.
+class PathArena {
+  private:
+    vector<PathStep> m_steps;
+    vector<int> m_offsets;
+
+  public:
+    PathArena();
+    void clear();
+    int getPathCount();
+    int addPath(vector<PathStep>*);
+    PathStep* getPath(int);
+    int getPathLength(int);
+    PathStep* getTarget(int);
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * ======================================================================
+ * RecurrenceTracker.cpp
+ * ======================================================================
+ * Recurrence constraints of the scheduled DFG nodes.
+ */
+
+#include "RecurrenceTracker.h"
+
+#define WORD_BITS 64
+
+RecurrenceTracker::RecurrenceTracker() {
+  m_II = 0;
+}
+
+// Indexes the nodes and the cycles of 't_dfg', none of the nodes being
+// scheduled yet.
+void RecurrenceTracker::reset(DFG* t_dfg, int t_II) {
+  m_II = t_II;
+  m_nodeIndex.clear();
+  for (DFGNode* dfgNode: t_dfg->nodes) {
+    int index = m_nodeIndex.size();
+    m_nodeIndex[dfgNode] = index;
+  }
+  m_timing.assign(m_nodeIndex.size(), -1);
+  m_nodeCycles.assign(m_nodeIndex.size(), vector<int>());
+  m_cycles.clear();
+  m_unscheduled.clear();
+  m_distances.clear();
+  for (list<DFGNode*>* cycle: *(t_dfg->getCycleLists())) {
+    int cycleID = m_cycles.size();
+    m_cycles.push_back(vector<int>());
+    for (DFGNode* dfgNode: *cycle) {
+      int node = m_nodeIndex[dfgNode];
+      m_cycles.back().push_back(node);
+      m_nodeCycles[node].push_back(cycleID);
+    }
+    m_distances.push_back(t_dfg->getIterationDistance(cycle));
+    m_unscheduled.push_back(cycle->size());
+  }
+  m_violated.assign((m_cycles.size() + WORD_BITS - 1) / WORD_BITS, 0);
+}
+
+// Whether the cycle is violated given the scheduled timings, 't_node'
+// being (tentatively) scheduled at 't_timing'.
+bool RecurrenceTracker::isCycleViolated(int t_cycle, int t_node,
+    int t_timing) {
+  vector<int>* cycle = &m_cycles[t_cycle];
+  int last = cycle->back();
+  int t1 = (last == t_node) ? t_timing : m_timing[last];
+  int wraps = 0;
+  for (int node: *cycle) {
+    int t2 = (node == t_node) ? t_timing : m_timing[node];
+    // The data reaches the next node in as many iterations as it takes to
+    // come after 't1'.
+    if (t1 >= t2)
+      wraps += (t1 - t2) / m_II + 1;
+    if (wraps > m_distances[t_cycle])
+      return true;
+    t1 = t2;
+  }
+  return false;
+}
+
+void RecurrenceTracker::setViolated(int t_cycle, bool t_violated) {
+  uint64_t bit = 1ULL << (t_cycle % WORD_BITS);
+  if (t_violated)
+    m_violated[t_cycle / WORD_BITS] |= bit;
+  else
+    m_violated[t_cycle / WORD_BITS] &= ~bit;
+}
+
+// The cycles of the node are checked as they get completed.
+void RecurrenceTracker::schedule(DFGNode* t_dfgNode, int t_timing) {
+  int node = m_nodeIndex[t_dfgNode];
+  if (m_timing[node] != -1)
+    unschedule(t_dfgNode);
+  m_timing[node] = t_timing;
+  for (int cycle: m_nodeCycles[node]) {
+    if (--m_unscheduled[cycle] == 0)
+      setViolated(cycle, isCycleViolated(cycle, -1, 0));
+  }
+}
+
+void RecurrenceTracker::unschedule(DFGNode* t_dfgNode) {
+  map<DFGNode*, int>::iterator iter = m_nodeIndex.find(t_dfgNode);
+  if (iter == m_nodeIndex.end() or m_timing[iter->second] == -1)
+    return;
+  int node = iter->second;
+  m_timing[node] = -1;
+  for (int cycle: m_nodeCycles[node]) {
+    if (m_unscheduled[cycle]++ == 0)
+      setViolated(cycle, false);
+  }
+}
+
+// Whether one of the cycles going through both nodes is violated.
+bool RecurrenceTracker::isViolated(DFGNode* t_a, DFGNode* t_b) {
+  vector<uint64_t>* aBits = t_a->getCycleBits();
+  vector<uint64_t>* bBits = t_b->getCycleBits();
+  unsigned words = min(aBits->size(), bBits->size());
+  if (words > m_violated.size())
+    words = m_violated.size();
+  for (unsigned i=0; i<words; ++i) {
+    if ((*aBits)[i] & (*bBits)[i] & m_violated[i])
+      return true;
+  }
+  return false;
+}
+
+// Whether scheduling the (unscheduled) node at 't_timing' would complete
+// a violated cycle. Such a placement fails once its data is routed, so it
+// can be rejected beforehand.
+bool RecurrenceTracker::wouldViolate(DFGNode* t_dfgNode, int t_timing) {
+  map<DFGNode*, int>::iterator iter = m_nodeIndex.find(t_dfgNode);
+  if (iter == m_nodeIndex.end() or m_timing[iter->second] != -1)
+    return false;
+  int node = iter->second;
+  for (int cycle: m_nodeCycles[node]) {
+    if (m_unscheduled[cycle] == 1 and
+        isCycleViolated(cycle, node, t_timing))
+      return true;
+  }
+  return false;
+}
+
+int RecurrenceTracker::getCycleCount() {
+  return m_cycles.size();
+}
+
+int RecurrenceTracker::getDistance(int t_cycle) {
+  return m_distances[t_cycle];
+}
+
+// The cycles the recurrence leaves out of the iterations it spans (its
+// distance times II). Walking the scheduled nodes of the cycle, a step
+// that does not go forward in time takes the data to a later iteration,
+// the cycles from the sending node to the receiving one in that iteration
+// are used up. With a single such step, e.g., the loop-carried edge, the
+// slack is negative iff the cycle is violated.
+int RecurrenceTracker::getSlack(int t_cycle) {
+  int slack = m_distances[t_cycle] * m_II;
+  int t1 = -1;
+  for (int node: m_cycles[t_cycle]) {
+    if (m_timing[node] != -1)
+      t1 = m_timing[node];
+  }
+  if (t1 == -1)
+    return slack;
+  for (int node: m_cycles[t_cycle]) {
+    int t2 = m_timing[node];
+    if (t2 == -1)
+      continue;
+    if (t1 >= t2)
+      slack -= t1 - t2 + 1;
+    t1 = t2;
+  }
+  return slack;
+}
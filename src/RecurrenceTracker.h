@@ -0,0 +1,51 @@
+/*
+ * ======================================================================
+ * RecurrenceTracker.h
+ * ======================================================================
+ * Recurrence constraints of the scheduled DFG nodes header file.
+ */
+
+#ifndef RecurrenceTracker_H
+#define RecurrenceTracker_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "DFG.h"
+
+using namespace std;
+
+// Keeps the verdict of every cycle of the DFG up to date while the DFG
+// nodes are scheduled and unscheduled. A cycle is only checked once all of
+// its nodes are scheduled: walking the cycle from node to node, the timing
+// can wrap around II at most as many times as the iteration distance of
+// the cycle (the sum over its edges, at least 1), i.e., the recurrence has
+// to fit in the iterations it spans. The violated cycles are kept as a bitset indexed like
+// the cycle bits of the DFG nodes, so whether the data between two nodes
+// breaks a recurrence is a few word operations.
+class RecurrenceTracker {
+  private:
+    int m_II;
+    map<DFGNode*, int> m_nodeIndex;
+    vector<int> m_timing;
+    vector<vector<int>> m_cycles;
+    vector<int> m_distances;
+    vector<vector<int>> m_nodeCycles;
+    vector<int> m_unscheduled;
+    vector<uint64_t> m_violated;
+    bool isCycleViolated(int, int, int);
+    void setViolated(int, bool);
+
+  public:
+    RecurrenceTracker();
+    void reset(DFG*, int);
+    void schedule(DFGNode*, int);
+    void unschedule(DFGNode*);
+    bool isViolated(DFGNode*, DFGNode*);
+    bool wouldViolate(DFGNode*, int);
+    int getCycleCount();
+    int getDistance(int);
+    int getSlack(int);
+};
+
+#endif
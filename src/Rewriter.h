@@ -11,9 +11,6 @@
 #include <memory>
 
 list<DFG*> *rewrite_for_CGRA(CGRA *cgra, DFG *dfg);
-// Just need to give things unique ids I thkn -- not sure
-// what they are used for.
-static int inserted_ids;
 
 using namespace llvm;
 
@@ -33,6 +30,14 @@ class SubToAddNeg: public RewriteRule {
 	SubToAddNeg () { };
 	virtual bool applyTo(DFG *graph) {
 		bool applied = false;
+		// Just need to give things unique ids I thkn -- not sure
+		// what they are used for.  Number the inserted nodes/edges
+		// after the ones of this graph.
+		int inserted_ids = 0;
+		for (DFGNode *dfgNode: graph->nodes) {
+			if (dfgNode->getID() >= inserted_ids)
+				inserted_ids = dfgNode->getID() + 1;
+		}
 		// Search the DFG graph for x - y and transform to x + (-1) * y
 		auto nodesToRemove = list<DFGNode *>();
 		for (DFGNode *dfgNode: graph->nodes) {
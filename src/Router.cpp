@@ -0,0 +1,208 @@
+/*
+ * ======================================================================
+ * Router.cpp
+ * ======================================================================
+ * Time-aware shortest path search over the CGRA links.
+ */
+
+#include "Router.h"
+#include <cstdlib>
+
+Router::Router(CGRA* t_cgra) {
+  m_cgra = t_cgra;
+  m_tileCount = t_cgra->getFUCount();
+  m_columns = t_cgra->getColumns();
+  m_distance = new int[m_tileCount];
+  m_timing = new int[m_tileCount];
+  m_previous = new int[m_tileCount];
+  m_heap = new int[m_tileCount];
+  m_heapIndex = new int[m_tileCount];
+  m_heapSize = 0;
+  m_congestionLog = NULL;
+  m_multicast = false;
+}
+
+Router::~Router() {
+  delete[] m_distance;
+  delete[] m_timing;
+  delete[] m_previous;
+  delete[] m_heap;
+  delete[] m_heapIndex;
+}
+
+CGRA* Router::getCGRA() {
+  return m_cgra;
+}
+
+// The (link, cycle) pairs the search could not take are appended to
+// 't_log' (NULL stops logging).
+void Router::setCongestionLog(vector<pair<CGRALink*, int>>* t_log) {
+  m_congestionLog = t_log;
+}
+
+// In the multicast mode, the data is preferably routed over the link slots
+// that already carry it to the other consumers, i.e., the route of each
+// consumer joins the time-expanded Steiner tree of the data (the shortest
+// path to the tree) and the shared slots are only taken once. A cycle then
+// costs the tile count and a hop over a shared slot one less: as a path
+// has fewer hops than tiles, the sharing never delays the data.
+void Router::setMulticast(bool t_multicast) {
+  m_multicast = t_multicast;
+}
+
+// Ties on the distance are broken by the tile ID so that the tiles are
+// visited in the same order as the row-major search pool.
+bool Router::isPrior(int t_a, int t_b) {
+  if (m_distance[t_a] != m_distance[t_b])
+    return m_distance[t_a] < m_distance[t_b];
+  return t_a < t_b;
+}
+
+void Router::swapHeapItems(int t_i, int t_j) {
+  int temp = m_heap[t_i];
+  m_heap[t_i] = m_heap[t_j];
+  m_heap[t_j] = temp;
+  m_heapIndex[m_heap[t_i]] = t_i;
+  m_heapIndex[m_heap[t_j]] = t_j;
+}
+
+void Router::siftUp(int t_i) {
+  while (t_i > 0) {
+    int parent = (t_i - 1) / 2;
+    if (!isPrior(m_heap[t_i], m_heap[parent]))
+      break;
+    swapHeapItems(t_i, parent);
+    t_i = parent;
+  }
+}
+
+void Router::siftDown(int t_i) {
+  while (1) {
+    int prior = t_i;
+    int left = 2 * t_i + 1;
+    int right = left + 1;
+    if (left < m_heapSize and isPrior(m_heap[left], m_heap[prior]))
+      prior = left;
+    if (right < m_heapSize and isPrior(m_heap[right], m_heap[prior]))
+      prior = right;
+    if (prior == t_i)
+      break;
+    swapHeapItems(t_i, prior);
+    t_i = prior;
+  }
+}
+
+// The distance of a tile only decreases during the search, so an update
+// only needs to sift the tile up.
+void Router::pushOrUpdate(int t_tile) {
+  if (m_heapIndex[t_tile] == -1) {
+    m_heap[m_heapSize] = t_tile;
+    m_heapIndex[t_tile] = m_heapSize;
+    ++m_heapSize;
+  }
+  siftUp(m_heapIndex[t_tile]);
+}
+
+int Router::popMin() {
+  int minTile = m_heap[0];
+  --m_heapSize;
+  if (m_heapSize > 0) {
+    swapHeapItems(0, m_heapSize);
+    siftDown(0);
+  }
+  m_heapIndex[minTile] = -1;
+  return minTile;
+}
+
+int Router::getHopDistance(int t_a, int t_b) {
+  return abs(t_a / m_columns - t_b / m_columns) +
+         abs(t_a % m_columns - t_b % m_columns);
+}
+
+// Searches the earliest arrival of the data produced by 't_srcDFGNode'
+// (available on 't_srcCGRANode' at 't_startCycle') on the other tiles.
+// The search stops once 't_dstCGRANode' is settled; NULL explores all the
+// tiles. Tiles that can not be reached keep 't_startCycle' as the timing.
+void Router::search(DFGNode* t_srcDFGNode, CGRANode* t_srcCGRANode,
+    int t_startCycle, int t_II, int t_maxCycle, CGRANode* t_dstCGRANode) {
+  int unit = 1;
+  int sharingBonus = 0;
+  if (m_multicast) {
+    unit = m_tileCount;
+    sharingBonus = 1;
+  }
+  // The least cost of a hop.
+  int hopCost = unit - sharingBonus;
+  for (int i=0; i<m_tileCount; ++i) {
+    m_distance[i] = t_maxCycle * unit;
+    m_timing[i] = t_startCycle;
+    m_previous[i] = -1;
+    m_heapIndex[i] = -1;
+  }
+  m_heapSize = 0;
+  int src = t_srcCGRANode->getID();
+  int dst = -1;
+  if (t_dstCGRANode != NULL)
+    dst = t_dstCGRANode->getID();
+  m_distance[src] = 0;
+  pushOrUpdate(src);
+  while (m_heapSize != 0) {
+    int current = popMin();
+    // found the target point in the shortest path
+    if (current == dst)
+      break;
+    // The hop distance is a lower bound of the remaining cost, a tile
+    // that can only reach the target later than the best known arrival
+    // is never part of the shortest path.
+    if (dst != -1 and m_distance[current] +
+        getHopDistance(current, dst) * hopCost > m_distance[dst])
+      continue;
+    CGRANode* currentNode = m_cgra->getNode(current);
+    for (CGRALink* link: *(currentNode->getOutLinks())) {
+      int neighbor = link->getDst()->getID();
+      int cycle = m_timing[current];
+      // The link is modulo reserved, waiting for more than II cycles does
+      // not make it available.
+      int lastCycle = m_timing[current] + t_II - 1;
+      if (lastCycle > t_maxCycle)
+        lastCycle = t_maxCycle;
+      while (1) {
+        // TODO: should also consider the cost of the register file
+        if (link->canOccupy(t_srcDFGNode, t_srcCGRANode, cycle, t_II)) {
+          // rough estimate the cost based on the suspend cycle
+          int cost = m_distance[current] + unit *
+              ((cycle - m_timing[current]) + 1 + link->getHistoryCost(cycle));
+          // The slots carrying the data of the same iteration are shared.
+          if (cycle - t_startCycle < t_II and
+              link->getMappedDFGNode(cycle) == t_srcDFGNode)
+            cost -= sharingBonus;
+          if (cost < m_distance[neighbor] and
+              (dst == -1 or cost + getHopDistance(neighbor, dst) * hopCost <=
+               m_distance[dst])) {
+            m_distance[neighbor] = cost;
+            m_timing[neighbor] = cycle + 1;
+            m_previous[neighbor] = current;
+            pushOrUpdate(neighbor);
+          }
+          break;
+        }
+        if (m_congestionLog != NULL)
+          m_congestionLog->push_back(make_pair(link, cycle));
+        ++cycle;
+        if (cycle > lastCycle)
+          break;
+      }
+    }
+  }
+}
+
+int Router::getTiming(CGRANode* t_cgraNode) {
+  return m_timing[t_cgraNode->getID()];
+}
+
+CGRANode* Router::getPrevious(CGRANode* t_cgraNode) {
+  int previous = m_previous[t_cgraNode->getID()];
+  if (previous == -1)
+    return NULL;
+  return m_cgra->getNode(previous);
+}
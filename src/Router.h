@@ -0,0 +1,57 @@
+/*
+ * ======================================================================
+ * Router.h
+ * ======================================================================
+ * Time-aware shortest path search over the CGRA links header file.
+ */
+
+#ifndef Router_H
+#define Router_H
+
+#include "CGRA.h"
+#include "DFGNode.h"
+#include <vector>
+
+// Routes the data produced by one DFG node from its tile to the others.
+// The cost of reaching a tile is the number of cycles since the data is
+// produced (one per hop plus the cycles waiting for a free link), so it is
+// bounded from below by the Manhattan hop distance. Tiles are indexed by
+// their ID (row-major), and the search pool is an indexed binary heap
+// ordered by (distance, tile ID), which visits the tiles in exactly the
+// order the former linear scan over the rows x columns pool did.
+// With the history rerouting, each hop also costs the history cost of the
+// link slot, and the slots that turn out to be taken are logged.
+class Router {
+  private:
+    CGRA* m_cgra;
+    int m_tileCount;
+    int m_columns;
+    int* m_distance;
+    int* m_timing;
+    int* m_previous;
+    int* m_heap;
+    int* m_heapIndex;
+    int m_heapSize;
+    vector<pair<CGRALink*, int>>* m_congestionLog;
+    bool m_multicast;
+
+    bool isPrior(int, int);
+    void swapHeapItems(int, int);
+    void siftUp(int);
+    void siftDown(int);
+    void pushOrUpdate(int);
+    int popMin();
+    int getHopDistance(int, int);
+
+  public:
+    Router(CGRA*);
+    ~Router();
+    CGRA* getCGRA();
+    void setCongestionLog(vector<pair<CGRALink*, int>>*);
+    void setMulticast(bool);
+    void search(DFGNode*, CGRANode*, int, int, int, CGRANode*);
+    int getTiming(CGRANode*);
+    CGRANode* getPrevious(CGRANode*);
+};
+
+#endif
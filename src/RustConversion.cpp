@@ -9,6 +9,9 @@
 #include <list>
 #include <map>
 #include <set>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 using namespace std;
 
@@ -17,20 +20,18 @@ typedef struct TempEdge {
 	int32_t to;
 } TempEdge;
 
-bool debugRustConversion = false;
-
-RustNode toRustNode(DFGNode *n, map<int, int> id_map) {
+RustNode toRustNode(DFGNode *n, map<int, int> *id_map, bool debug) {
 	uint32_t num_children = n->getPredNodes()->size();
-	if (debugRustConversion) {
+	if (debug) {
 		errs() << "Converting node (" << num_children << " children) from DFG to Rust: " << n->asString() << "\n";
 	}
 	uint32_t *child_ids = (uint32_t*) malloc(num_children * sizeof(uint32_t));
 
 	int i = 0;
 	for (DFGNode *pred: *n->getPredNodes()) {
-		child_ids[i] = id_map[pred->getID()];
-		if (debugRustConversion) {
-			errs() << "ADDing ID " << child_ids[i] << " --same as-- " << id_map.at(pred->getID()) << " from " << pred->getID() << "\n";
+		child_ids[i] = (*id_map)[pred->getID()];
+		if (debug) {
+			errs() << "ADDing ID " << child_ids[i] << " --same as-- " << id_map->at(pred->getID()) << " from " << pred->getID() << "\n";
 			errs() << "ID was for node " << pred->asString() << "\n";
 		}
 		i ++;
@@ -46,7 +47,7 @@ RustNode toRustNode(DFGNode *n, map<int, int> id_map) {
 	rnode.num_children = num_children;
 	rnode.child_ids = child_ids;
 
-	if (debugRustConversion) {
+	if (debug) {
 		errs() << "Child IDs are: ";
 		for (int i = 0; i < rnode.num_children; i ++) {
 			errs() << rnode.child_ids[i] << ", ";
@@ -66,11 +67,11 @@ RustDFG toRustDFG(DFG *dfg, Options *options) {
 	// RustNode *nodes = (RustNode* )malloc(sizeof(RustNode) * dfg->nodes.size());
 	auto nodes = std::make_unique<RustNode[]>(dfg->nodes.size());
 	int node_index = 0;
-	list<DFGNode *> ordered_nodes = topo_sort(dfg->nodes);
+	list<DFGNode *> ordered_nodes = topo_sort(dfg->nodes, options->DebugRustConversion);
 
 	// Build a lookup table for names.
 	for (DFGNode *n : ordered_nodes) {
-		if (debugRustConversion) {
+		if (options->DebugRustConversion) {
 			errs() << "Setting ID of " << n->asString() << " to " << node_index << "\n";
 		}
 		id_lookup.insert({n->getID(), node_index});
@@ -79,9 +80,9 @@ RustDFG toRustDFG(DFG *dfg, Options *options) {
 
 	node_index = 0;
 	for (DFGNode *n : ordered_nodes) {
-		if (debugRustConversion)
+		if (options->DebugRustConversion)
 			errs() << "Adding " << n->getID() << ", " << node_index << "to pattern\n";
-		nodes[node_index] = toRustNode(n, id_lookup);
+		nodes[node_index] = toRustNode(n, &id_lookup, options->DebugRustConversion);
 		node_index ++;
 	}
 
@@ -90,7 +91,7 @@ RustDFG toRustDFG(DFG *dfg, Options *options) {
 	rustDfg.num_nodes = node_index;
 
 	// DEBUG >>>
-	if (debugRustConversion) {
+	if (options->DebugRustConversion) {
 		for (int i = 0; i < rustDfg.num_nodes; i++) {
 			auto node = rustDfg.nodes[i];
 			std::cout << i << ": " << node.op << " with children: [ ";
@@ -130,7 +131,7 @@ DFGNode *getNodeFromIndex(list<DFGNode *> *nodes, int index) {
 	return nullptr;
 }
 
-DFG* toDFG(RustDFG rustDfg) {
+DFG* toDFG(RustDFG rustDfg, bool debug) {
   // gh512 DEBUG
   // std::cout << "[CPP] checking" << std::endl;
 	// for (int i = 0; i < rustDfg.num_nodes; i ++) {
@@ -155,7 +156,7 @@ DFG* toDFG(RustDFG rustDfg) {
   // std::cout << "[CPP] OK" << std::endl;
 
 
-	if (debugRustConversion)
+	if (debug)
 		errs() << "Starting to convert to DFG\n";
 
 	list<DFGNode*> *dnodes = new list<DFGNode*>();
@@ -168,20 +169,20 @@ DFG* toDFG(RustDFG rustDfg) {
 	list<TempEdge> *temp_edges = new list<TempEdge>();
 	list<DFGEdge*> *dedges = new list<DFGEdge*>();
 
-	if (debugRustConversion)
+	if (debug)
 		errs() << "Starting to process graph: Nodes in total is " << rustDfg.num_nodes << "\n";
 	for (int i = 0; i < rustDfg.num_nodes; i ++) {
-		if (debugRustConversion)
+		if (debug)
 			errs() << "Starting on RNode " << i << "\n";
 		// get the children from this node.
 		RustNode rnode = rustDfg.nodes[i];
-		if (debugRustConversion) {
+		if (debug) {
 			errs() << "Inspecting RNode: " << rnode_as_string(rnode) << "\n";
 			errs() << "Node has " << rnode.num_children << " children\n";
 		}
 		DFGNode *dfgnode = toDFGNode(rnode, i);
 		dnode_map->insert({i, dfgnode});
-		if (debugRustConversion)
+		if (debug)
 			errs() << "Created DFGNode " << dfgnode->asString() << " (Edges not yet attached)\n";
 		// keep track of the edges we'll need to construct later.
 		for (int j = 0; j < rnode.num_children; j ++) {
@@ -206,7 +207,7 @@ DFG* toDFG(RustDFG rustDfg) {
 
 		fromNode->setOutEdge(new_edge);
 		toNode->setInEdge(new_edge);
-		if (debugRustConversion)
+		if (debug)
 			errs() << "Added edge between " << std::to_string(e.from) << " and " << std::to_string(e.to) << "\n";
 	}
 
@@ -217,7 +218,6 @@ DFG* toDFG(RustDFG rustDfg) {
 
 // As below, but use the rewrite_with_graphs interface instead.
 list<DFG*> *rewrite_with_graphs(Options *opts, CGRA *cgra, DFG *dfg) {
-	debugRustConversion = opts->DebugRustConversion;
 
 	RustDFG rdfg = toRustDFG(dfg, opts);
 	if (opts->DebugRustConversion) {
@@ -241,7 +241,7 @@ list<DFG*> *rewrite_with_graphs(Options *opts, CGRA *cgra, DFG *dfg) {
 
 	list<DFG*> *dfg_results = new list<DFG*>();
 	for (int i = 0; i < rust_results.num_dfgs; i ++) {
-		dfg_results->push_back(toDFG(rust_results.dfgs[i]));
+		dfg_results->push_back(toDFG(rust_results.dfgs[i], opts->DebugRustConversion));
 	}
 
 	if (opts->DebugRustConversion) {
@@ -252,7 +252,6 @@ list<DFG*> *rewrite_with_graphs(Options *opts, CGRA *cgra, DFG *dfg) {
 }
 
 list<DFG*> *rewrite_with_egraphs(Options *opts, CGRA *cgra, DFG *dfg) {
-	debugRustConversion = opts->DebugRustConversion;
 	// Create the Rust DFGs:
 	RustDFG rdfg = toRustDFG(dfg, opts);
 	// Call the rewriter
@@ -269,7 +268,7 @@ list<DFG*> *rewrite_with_egraphs(Options *opts, CGRA *cgra, DFG *dfg) {
 	list<DFG*> *dfg_results = new list<DFG*>();
 	for (int i = 0; i < rust_results.num_dfgs; i ++) {
 		// convert each result to a dfg.
-		dfg_results->push_back(toDFG(rust_results.dfgs[i]));
+		dfg_results->push_back(toDFG(rust_results.dfgs[i], opts->DebugRustConversion));
 	}
 	if (opts->DebugRustConversion) {
 		errs() << "Returning " << rust_results.num_dfgs << " graphs from the Rust wrapper\n";
@@ -280,7 +279,6 @@ list<DFG*> *rewrite_with_egraphs(Options *opts, CGRA *cgra, DFG *dfg) {
 }
 
 list<DFG*> *rewrite_with_mcts(Options *opts, CGRA *cgra, DFG *dfg) {
-	debugRustConversion = opts->DebugRustConversion;
 	// Create the Rust DFGs:
 	RustDFG rdfg = toRustDFG(dfg, opts);
 	// Call the rewriter
@@ -297,7 +295,7 @@ list<DFG*> *rewrite_with_mcts(Options *opts, CGRA *cgra, DFG *dfg) {
 	list<DFG*> *dfg_results = new list<DFG*>();
 	for (int i = 0; i < rust_results.num_dfgs; i ++) {
 		// convert each result to a dfg.
-		dfg_results->push_back(toDFG(rust_results.dfgs[i]));
+		dfg_results->push_back(toDFG(rust_results.dfgs[i], opts->DebugRustConversion));
 	}
 	if (opts->DebugRustConversion) {
 		errs() << "Returning " << rust_results.num_dfgs << " graphs from the Rust wrapper\n";
@@ -307,65 +305,85 @@ list<DFG*> *rewrite_with_mcts(Options *opts, CGRA *cgra, DFG *dfg) {
 	return dfg_results;
 }
 
-// Only works for loop-free graphs.
-list <DFGNode *> topo_sort(list <DFGNode *> in_nodes) {
-	list<DFGNode*> out_nodes;
-	set<DFGNode*> added_nodes;
-	int iteration_count = 0;
+// Only works for loop-free graphs. The nodes are visited in sweeps over
+// 'in_nodes', a node being taken as soon as all of its predecessors have
+// been taken (possibly earlier in the same sweep). Rather than sweeping
+// until all the nodes are taken, the sweep of each node is found in a
+// single pass in topological order: it is the sweep of its latest
+// predecessor, or the one after that if the predecessor comes later in
+// 'in_nodes'.
+list <DFGNode *> topo_sort(list <DFGNode *> in_nodes, bool debug) {
+	vector<DFGNode*> ordered(in_nodes.begin(), in_nodes.end());
+	int node_count = ordered.size();
+	unordered_map<DFGNode*, int> positions;
+	for (int i = 0; i < node_count; i ++) {
+		positions.emplace(ordered[i], i);
+	}
 
-	while (out_nodes.size() < in_nodes.size()) {
-		if (debugRustConversion) {
-			errs() << "Starting iteration " << iteration_count << "\n";
-			errs() << "Added nodes size is " << added_nodes.size() << ", " << in_nodes.size() << "\n";
-		}
-		if (iteration_count > in_nodes.size()) {
-			errs() << "Yet to add instructions: " ;
-			errs() << "Iteration count reached " << iteration_count << " but only had " << in_nodes.size() << " in nodes\n";
-			for (DFGNode * still_to_add : in_nodes) {
-				if (added_nodes.find(still_to_add) == added_nodes.end()) {
-					errs() << still_to_add->asString() << "\n ";
-				} else {
-					// node was added
+	vector<vector<int>> consumers(node_count);
+	vector<int> pending(node_count, 0);
+	vector<int> sweeps(node_count, 0);
+	vector<int> ready;
+	for (int i = 0; i < node_count; i ++) {
+		for (DFGNode *pNode : *ordered[i]->getPredNodes()) {
+			unordered_map<DFGNode*, int>::iterator pred = positions.find(pNode);
+			if (pred == positions.end()) {
+				// The dependency can never be added.
+				if (debug) {
+					errs() << "Failed to add due to node " << pNode->asString() << "\n";
 				}
-			}
-			errs() << "\n";
-			throw std::domain_error("Unsupported Circular DFG --- Only inner loops are supported for scheduling.");
-		}
-		iteration_count ++;
-		for (DFGNode *n : in_nodes) {
-			// errs() << "Looking at node " << n->asString() << "\n";
-			if (added_nodes.find(n) != added_nodes.end()) {
-				if (debugRustConversion) {
-					errs() << "(Already added)\n";
-				}
-				// Already added this node.
+				pending[i] = node_count + 1;
 				continue;
-			} else {
-				if (debugRustConversion) {
-					errs() << "(Looking to add...)\n";
-				}
 			}
+			consumers[pred->second].push_back(i);
+			pending[i] ++;
+		}
+		if (pending[i] == 0) {
+			ready.push_back(i);
+		}
+	}
 
-			// Check if the node can be added.
-			bool can_add = true;
-			for (DFGNode *pNode : *n->getPredNodes()) {
-				if (added_nodes.find(pNode) == added_nodes.end()) {
-					// we haven't yet added the dependency.
-					if (debugRustConversion) {
-						errs() << "Failed to add due to node " << pNode ->asString() << "\n";
-					}
-					can_add = false;
-				}
+	for (unsigned head = 0; head < ready.size(); head ++) {
+		int current = ready[head];
+		for (int consumer : consumers[current]) {
+			int sweep = sweeps[current] + (current >= consumer ? 1 : 0);
+			if (sweeps[consumer] < sweep) {
+				sweeps[consumer] = sweep;
+			}
+			pending[consumer] --;
+			if (pending[consumer] == 0) {
+				ready.push_back(consumer);
 			}
+		}
+	}
 
-			if (can_add) {
-				if (debugRustConversion) {
-					errs() << "(Adding) node\n";
-				}
-				out_nodes.push_back(n);
-				added_nodes.insert(n);
+	if ((int) ready.size() < node_count) {
+		vector<bool> added(node_count, false);
+		for (int i : ready) {
+			added[i] = true;
+		}
+		errs() << "Yet to add instructions: " ;
+		for (int i = 0; i < node_count; i ++) {
+			if (!added[i]) {
+				errs() << ordered[i]->asString() << "\n ";
 			}
 		}
+		errs() << "\n";
+		throw std::domain_error("Unsupported Circular DFG --- Only inner loops are supported for scheduling.");
+	}
+
+	// Order by sweep, and by the position in 'in_nodes' within a sweep.
+	std::sort(ready.begin(), ready.end(), [&sweeps](int a, int b) {
+		if (sweeps[a] != sweeps[b])
+			return sweeps[a] < sweeps[b];
+		return a < b;
+	});
+	list<DFGNode*> out_nodes;
+	for (int i : ready) {
+		if (debug) {
+			errs() << "(Adding) node " << ordered[i]->asString() << " in sweep " << sweeps[i] << "\n";
+		}
+		out_nodes.push_back(ordered[i]);
 	}
 
 	// Need to return the 'leaf' nodes first.
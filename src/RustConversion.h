@@ -6,5 +6,5 @@
 
 list <DFG*> *rewrite_with_egraphs(Options *options, CGRA *cgra, DFG *dfg);
 list <DFG*> *rewrite_with_graphs(Options *options, CGRA *cgra, DFG *dfg);
-list <DFGNode *> topo_sort(list <DFGNode *> in_nodes);
+list <DFGNode *> topo_sort(list <DFGNode *> in_nodes, bool debug = false);
 list <DFG*> *rewrite_with_mcts(Options *options, CGRA *cgra, DFG *dfg);
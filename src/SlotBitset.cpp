@@ -0,0 +1,135 @@
+/*
+ * ======================================================================
+ * SlotBitset.cpp
+ * ======================================================================
+ * Packed occupancy of the modulo slots.
+ */
+
+#include "SlotBitset.h"
+
+#define WORD_BITS 64
+
+// The bits [t_begin, t_end) of a word, 't_end' being at most WORD_BITS.
+static uint64_t getWordMask(int t_begin, int t_end) {
+  uint64_t high = (t_end == WORD_BITS) ? ~0ULL : ((1ULL << t_end) - 1);
+  return high & ~((1ULL << t_begin) - 1);
+}
+
+SlotBitset::SlotBitset() {
+  m_size = 0;
+}
+
+// Resizes the bitset to 't_size' slots and clears all of them.
+void SlotBitset::reset(int t_size) {
+  m_size = t_size;
+  m_words.assign((t_size + WORD_BITS - 1) / WORD_BITS, 0);
+}
+
+int SlotBitset::size() {
+  return m_size;
+}
+
+bool SlotBitset::test(int t_slot) {
+  return (m_words[t_slot / WORD_BITS] >> (t_slot % WORD_BITS)) & 1ULL;
+}
+
+// Sets the bits of 't_mask' in the word, recording the old word if the
+// word changes.
+void SlotBitset::setWord(int t_word, uint64_t t_mask, MappingTrail* t_trail) {
+  if ((m_words[t_word] | t_mask) == m_words[t_word])
+    return;
+  if (t_trail != NULL)
+    t_trail->saveWord(&m_words[t_word]);
+  m_words[t_word] |= t_mask;
+}
+
+void SlotBitset::set(int t_slot, MappingTrail* t_trail) {
+  setWord(t_slot / WORD_BITS, 1ULL << (t_slot % WORD_BITS), t_trail);
+}
+
+bool SlotBitset::any() {
+  for (uint64_t word: m_words) {
+    if (word != 0)
+      return true;
+  }
+  return false;
+}
+
+int SlotBitset::count() {
+  int bits = 0;
+  for (uint64_t word: m_words)
+    bits += __builtin_popcountll(word);
+  return bits;
+}
+
+// Whether any slot in [t_begin, t_end) is set, without wrapping around.
+bool SlotBitset::anyInLinearRange(int t_begin, int t_end) {
+  while (t_begin < t_end) {
+    int word = t_begin / WORD_BITS;
+    int wordEnd = (word + 1) * WORD_BITS;
+    if (wordEnd > t_end)
+      wordEnd = t_end;
+    uint64_t mask = getWordMask(t_begin % WORD_BITS,
+                                wordEnd - word * WORD_BITS);
+    if (m_words[word] & mask)
+      return true;
+    t_begin = wordEnd;
+  }
+  return false;
+}
+
+void SlotBitset::setLinearRange(int t_begin, int t_end,
+                                MappingTrail* t_trail) {
+  while (t_begin < t_end) {
+    int word = t_begin / WORD_BITS;
+    int wordEnd = (word + 1) * WORD_BITS;
+    if (wordEnd > t_end)
+      wordEnd = t_end;
+    setWord(word, getWordMask(t_begin % WORD_BITS,
+                              wordEnd - word * WORD_BITS), t_trail);
+    t_begin = wordEnd;
+  }
+}
+
+// Whether any of the 't_length' slots starting from 't_slot' is set. The
+// window wraps around the last slot.
+bool SlotBitset::anyInRange(int t_slot, int t_length) {
+  if (t_length <= 0)
+    return false;
+  if (t_length >= m_size)
+    return any();
+  int end = t_slot + t_length;
+  if (end <= m_size)
+    return anyInLinearRange(t_slot, end);
+  return anyInLinearRange(t_slot, m_size) or
+         anyInLinearRange(0, end - m_size);
+}
+
+void SlotBitset::setRange(int t_slot, int t_length, MappingTrail* t_trail) {
+  if (t_length <= 0)
+    return;
+  if (t_length >= m_size) {
+    setLinearRange(0, m_size, t_trail);
+    return;
+  }
+  int end = t_slot + t_length;
+  if (end <= m_size) {
+    setLinearRange(t_slot, end, t_trail);
+  } else {
+    setLinearRange(t_slot, m_size, t_trail);
+    setLinearRange(0, end - m_size, t_trail);
+  }
+}
+
+bool SlotBitset::intersects(SlotBitset& t_other) {
+  for (unsigned i=0; i<m_words.size(); ++i) {
+    if (m_words[i] & t_other.m_words[i])
+      return true;
+  }
+  return false;
+}
+
+void SlotBitset::unite(SlotBitset& t_other, MappingTrail* t_trail) {
+  for (unsigned i=0; i<m_words.size(); ++i)
+    setWord(i, t_other.m_words[i], t_trail);
+}
@@ -0,0 +1,43 @@
+/*
+ * ======================================================================
+ * SlotBitset.h
+ * ======================================================================
+ * Packed occupancy of the modulo slots header file.
+ */
+
+#ifndef SlotBitset_H
+#define SlotBitset_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "MappingTrail.h"
+
+using namespace std;
+
+// One bit per modulo slot, packed into 64-bit words so that checking a
+// window of slots (wrapping around II) is a few masked word operations.
+// The updates are recorded into the given trail (if any) to be undone.
+class SlotBitset {
+  private:
+    int m_size;
+    vector<uint64_t> m_words;
+    bool anyInLinearRange(int, int);
+    void setLinearRange(int, int, MappingTrail*);
+    void setWord(int, uint64_t, MappingTrail*);
+
+  public:
+    SlotBitset();
+    void reset(int);
+    int size();
+    bool test(int);
+    void set(int, MappingTrail* t_trail=NULL);
+    bool any();
+    int count();
+    bool anyInRange(int, int);
+    void setRange(int, int, MappingTrail* t_trail=NULL);
+    bool intersects(SlotBitset&);
+    void unite(SlotBitset&, MappingTrail* t_trail=NULL);
+};
+
+#endif
@@ -12,9 +12,9 @@ int main(int argc, char **argv) {
     Parameters *params = new Parameters(opts->Params);
 
     DFG *dfg = new DFG(topts->dfg_file);
-    CGRA *cgra = params->getCGRA(opts);
+    MappingContext *context = new MappingContext(opts, params);
 
     cout << "Running mapping for DFG " << dfg->asString() << "\n";
 
-    runMapping(cgra, dfg, params, opts);
+    runMapping(context, dfg);
 }
\ No newline at end of file
@@ -84,10 +84,7 @@ namespace {
       /* if (options.DumpDFG) { */
       /*   dfg->dumpAsJson("DFG.json"); */
       /* } */
-      CGRA* cgra = params->getCGRA(options);
-      cgra->setRegConstraint(params->regConstraint);
-      cgra->setCtrlMemConstraint(params->ctrlMemConstraint);
-      cgra->setBypassConstraint(params->bypassConstraint);
+      MappingContext* context = new MappingContext(options, params);
 
         // Generate the DFG dot file.
         // errs() << "==================================\n";
@@ -98,7 +95,8 @@ namespace {
         return false;
       }
 
-      runMapping(cgra, dfg, params, options);
+      runMapping(context, dfg);
+      delete context;
 
       return false;
     }
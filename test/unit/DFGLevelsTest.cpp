@@ -0,0 +1,66 @@
+/*
+ * ======================================================================
+ * DFGLevelsTest.cpp
+ * ======================================================================
+ * ASAP/ALAP levels of small DFGs loaded from json files.
+ */
+
+#include <vector>
+#include "mapperTests.h"
+#include "DFG.h"
+#include "DFGLevels.h"
+
+void testDFGLevels() {
+  // a -> b -> c -> e and a -> d -> e, d can be one cycle late.
+  DFG dag("dag.json");
+  vector<DFGNode*> dfgNodes(dag.nodes.begin(), dag.nodes.end());
+  DFGNode* a = dfgNodes[0];
+  DFGNode* b = dfgNodes[1];
+  DFGNode* c = dfgNodes[2];
+  DFGNode* d = dfgNodes[3];
+  DFGNode* e = dfgNodes[4];
+  {
+    DFGLevels levels(&dag.nodes);
+    CHECK(levels.getLength() == 4);
+    CHECK(levels.getASAP(a) == 0 and levels.getALAP(a) == 0);
+    CHECK(levels.getASAP(b) == 1 and levels.getALAP(b) == 1);
+    CHECK(levels.getASAP(c) == 2 and levels.getALAP(c) == 2);
+    CHECK(levels.getASAP(d) == 1 and levels.getALAP(d) == 2);
+    CHECK(levels.getASAP(e) == 3 and levels.getALAP(e) == 3);
+    CHECK(levels.getMobility(d) == 1 and levels.getMobility(c) == 0);
+    CHECK(levels.getHeight(a) == 4 and levels.getHeight(d) == 2);
+    // The topological order puts every node after its predecessors.
+    vector<int>* order = levels.getTopologicalOrder();
+    DFGAdjacency* adjacency = levels.getAdjacency();
+    vector<int> position(order->size());
+    for (unsigned k=0; k<order->size(); ++k)
+      position[(*order)[k]] = k;
+    for (int u=0; u<adjacency->getNodeCount(); ++u) {
+      for (int i=adjacency->getSuccBegin(u); i<adjacency->getSuccEnd(u); ++i)
+        CHECK(position[u] < position[adjacency->getSucc(i)]);
+    }
+  }
+
+  // With 3 cycles of latency on d, the longest path goes through it.
+  d->setExecLatency(3);
+  {
+    DFGLevels levels(&dag.nodes);
+    CHECK(levels.getLength() == 5);
+    CHECK(levels.getASAP(e) == 4 and levels.getALAP(e) == 4);
+    CHECK(levels.getMobility(d) == 0);
+    CHECK(levels.getMobility(b) == 1 and levels.getMobility(c) == 1);
+  }
+
+  // The edge c -> a closes the cycle, it is left out.
+  DFG cycle("cycle.json");
+  DFGLevels levels(&cycle.nodes);
+  dfgNodes.assign(cycle.nodes.begin(), cycle.nodes.end());
+  CHECK(levels.getLength() == 5);
+  for (int i=0; i<5; ++i)
+    CHECK(levels.getASAP(dfgNodes[i]) == i);
+  DFGAdjacency* adjacency = levels.getAdjacency();
+  int tail = adjacency->getIndex(dfgNodes[3]);
+  for (int i=adjacency->getSuccBegin(tail); i<adjacency->getSuccEnd(tail); ++i)
+    CHECK(levels.isBackEdge(i) == (adjacency->getSucc(i) ==
+                                   adjacency->getIndex(dfgNodes[1])));
+}
@@ -0,0 +1,86 @@
+/*
+ * ======================================================================
+ * MappingTrailTest.cpp
+ * ======================================================================
+ * Undoing the trail to a mark restores the MRRG exactly.
+ */
+
+#include <stdint.h>
+#include <vector>
+#include "mapperTests.h"
+#include "CGRA.h"
+#include "DFG.h"
+#include "MappingTrail.h"
+
+static intptr_t mappedID(DFGNode* t_dfgNode) {
+  return t_dfgNode == NULL ? -1 : t_dfgNode->getID();
+}
+
+// Everything the mapper can observe of the MRRG.
+static vector<intptr_t> snapshot(CGRA* t_cgra, int t_II, int t_regCount) {
+  vector<intptr_t> state;
+  for (int id=0; id<t_cgra->getFUCount(); ++id) {
+    CGRANode* node = t_cgra->getNode(id);
+    state.push_back(node->getCurrentCtrlMemItems());
+    for (int cycle=0; cycle<2*t_II; ++cycle) {
+      state.push_back(node->isOccupied(cycle, t_II));
+      state.push_back(mappedID(node->getMappedDFGNode(cycle)));
+    }
+    for (int cycle=0; cycle<t_II; ++cycle) {
+      int* regs = node->getRegsAllocation(cycle);
+      state.insert(state.end(), regs, regs + t_regCount);
+    }
+  }
+  for (int i=0; i<t_cgra->getLinkCount(); ++i) {
+    CGRALink* link = t_cgra->links[i];
+    state.push_back(link->getCurrentCtrlMemItems());
+    for (int cycle=0; cycle<t_II; ++cycle) {
+      state.push_back(link->isOccupied(cycle));
+      state.push_back(link->isBypass(cycle));
+      state.push_back(link->isReused(cycle));
+      state.push_back(mappedID(link->getMappedDFGNode(cycle)));
+    }
+  }
+  return state;
+}
+
+void testMappingTrail() {
+  Options opts;
+  opts.BuildCGRA = false;
+  Parameters params("param.json");
+  CGRA* cgra = params.getCGRA(&opts);
+  cgra->setRegConstraint(params.regConstraint);
+  cgra->setCtrlMemConstraint(params.ctrlMemConstraint);
+  cgra->setBypassConstraint(params.bypassConstraint);
+  DFG dfg("chain.json");
+  vector<DFGNode*> dfgNodes(dfg.nodes.begin(), dfg.nodes.end());
+
+  int II = 3;
+  cgra->constructMRRG(II);
+  MappingTrail trail;
+  cgra->setTrail(&trail);
+  vector<intptr_t> fresh = snapshot(cgra, II, params.regConstraint);
+
+  // Place 'a' and route it to 'b' through the center node.
+  CGRANode* n0 = cgra->getNode(0);
+  CGRANode* n1 = cgra->getNode(1);
+  CGRANode* n4 = cgra->getNode(4);
+  int mark = trail.mark();
+  n0->setDFGNode(dfgNodes[0], 0, II, false);
+  cgra->getLink(n0, n1)->occupy(dfgNodes[0], 1, 1, II, true, true, false);
+  cgra->getLink(n1, n4)->occupy(dfgNodes[0], 2, 2, II, false, false, false);
+  vector<intptr_t> placed = snapshot(cgra, II, params.regConstraint);
+  CHECK(placed != fresh);
+
+  // A nested mark only takes back the updates after it.
+  int nestedMark = trail.mark();
+  n4->setDFGNode(dfgNodes[1], 4, II, false);
+  cgra->getLink(n4, n1)->occupy(dfgNodes[1], 5, 1, II, false, true, false);
+  CHECK(snapshot(cgra, II, params.regConstraint) != placed);
+  trail.undo(nestedMark);
+  CHECK(snapshot(cgra, II, params.regConstraint) == placed);
+
+  trail.undo(mark);
+  CHECK(snapshot(cgra, II, params.regConstraint) == fresh);
+  cgra->setTrail(NULL);
+}
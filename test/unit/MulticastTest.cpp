@@ -0,0 +1,42 @@
+/*
+ * ======================================================================
+ * MulticastTest.cpp
+ * ======================================================================
+ * A link slot that carries a value to several consumers is configured
+ * once.
+ */
+
+#include <vector>
+#include "mapperTests.h"
+#include "CGRA.h"
+#include "DFG.h"
+
+void testMulticast() {
+  Options opts;
+  opts.BuildCGRA = false;
+  Parameters params("param.json");
+  CGRA* cgra = params.getCGRA(&opts);
+  cgra->setRegConstraint(params.regConstraint);
+  cgra->setCtrlMemConstraint(params.ctrlMemConstraint);
+  cgra->setBypassConstraint(params.bypassConstraint);
+  DFG dfg("chain.json");
+  vector<DFGNode*> dfgNodes(dfg.nodes.begin(), dfg.nodes.end());
+
+  int II = 4;
+  cgra->constructMRRG(II);
+  CGRALink* link = cgra->getLink(cgra->getNode(0), cgra->getNode(1));
+  link->occupy(dfgNodes[0], 1, 1, II, true, true, false);
+  CHECK(link->getCurrentCtrlMemItems() == 1);
+  // The route of a second consumer of 'a' goes through the same slot.
+  CHECK(link->canOccupy(dfgNodes[0], cgra->getNode(0), 1, II));
+  link->occupy(dfgNodes[0], 1, 1, II, true, true, false);
+  CHECK(link->getCurrentCtrlMemItems() == 1);
+  CHECK(link->getMappedDFGNode(1) == dfgNodes[0]);
+  // Another value, or the same one in another slot, is configured again.
+  CHECK(!link->canOccupy(dfgNodes[1], cgra->getNode(0), 1, II));
+  link->occupy(dfgNodes[0], 2, 1, II, true, true, false);
+  CHECK(link->getCurrentCtrlMemItems() == 2);
+  link->occupy(dfgNodes[1], 3, 1, II, true, true, false);
+  CHECK(link->getCurrentCtrlMemItems() == 3);
+  delete cgra;
+}
@@ -0,0 +1,27 @@
+/*
+ * ======================================================================
+ * RecMIITest.cpp
+ * ======================================================================
+ * The RecMII of the DFGs loaded from json files.
+ */
+
+#include "mapperTests.h"
+#include "DFG.h"
+#include "Mapper.h"
+
+void testRecMII() {
+  Mapper mapper;
+
+  // Without any cycle, nothing bounds the II.
+  DFG chain("chain.json");
+  CHECK(mapper.getRecMII(&chain) == 0);
+
+  // The cycle a -> b -> c -> a has no loop-carried edge: it is taken as one
+  // iteration, so its 3 cycles of latency, not the 5 of the whole DFG.
+  DFG cycle("cycle.json");
+  CHECK(mapper.getRecMII(&cycle) == 3);
+
+  // The same cycle closed by an edge of distance 2 fits in ceil(3/2).
+  DFG carriedCycle("carriedCycle.json");
+  CHECK(mapper.getRecMII(&carriedCycle) == 2);
+}
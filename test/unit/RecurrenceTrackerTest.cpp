@@ -0,0 +1,66 @@
+/*
+ * ======================================================================
+ * RecurrenceTrackerTest.cpp
+ * ======================================================================
+ * A recurrence can wrap around II as many times as its iteration distance.
+ */
+
+#include <vector>
+#include "mapperTests.h"
+#include "DFG.h"
+#include "RecurrenceTracker.h"
+
+// Schedules a, b and c of the cycle a -> b -> c -> a at 0, 1 and 2 with
+// II 't_II' and tells whether the cycle is violated.
+static bool isCycleViolated(DFG* t_dfg, int t_II) {
+  t_dfg->calculateCycles();
+  vector<DFGNode*> dfgNodes(t_dfg->nodes.begin(), t_dfg->nodes.end());
+  DFGNode* a = dfgNodes[1];
+  DFGNode* b = dfgNodes[2];
+  DFGNode* c = dfgNodes[3];
+  RecurrenceTracker recurrences;
+  recurrences.reset(t_dfg, t_II);
+  recurrences.schedule(a, 0);
+  recurrences.schedule(b, 1);
+  bool wouldViolate = recurrences.wouldViolate(c, 2);
+  recurrences.schedule(c, 2);
+  CHECK(recurrences.isViolated(a, c) == wouldViolate);
+  recurrences.unschedule(b);
+  CHECK(!recurrences.isViolated(a, c));
+  return wouldViolate;
+}
+
+void testRecurrenceTracker() {
+  // From c back to a, the data wraps around II once with II 3, twice
+  // with II 2.
+  DFG cycle("cycle.json");
+  CHECK(!isCycleViolated(&cycle, 3));
+  CHECK(isCycleViolated(&cycle, 2));
+
+  // The loop-carried edge of distance 2 allows the second wrap.
+  DFG carriedCycle("carriedCycle.json");
+  CHECK(!isCycleViolated(&carriedCycle, 3));
+  CHECK(!isCycleViolated(&carriedCycle, 2));
+  CHECK(isCycleViolated(&carriedCycle, 1));
+
+  // The data from c at 2 reaches a at 0 in the next iteration (II 3) or
+  // two iterations later (II 2), it uses 3 cycles of them.
+  vector<DFGNode*> dfgNodes(carriedCycle.nodes.begin(),
+                            carriedCycle.nodes.end());
+  RecurrenceTracker recurrences;
+  recurrences.reset(&carriedCycle, 2);
+  CHECK(recurrences.getCycleCount() == 1);
+  CHECK(recurrences.getDistance(0) == 2);
+  CHECK(recurrences.getSlack(0) == 4);
+  recurrences.schedule(dfgNodes[1], 0);
+  recurrences.schedule(dfgNodes[2], 1);
+  recurrences.schedule(dfgNodes[3], 2);
+  CHECK(recurrences.getSlack(0) == 1);
+  // Without b, the same cycles are used from c to a.
+  dfgNodes.assign(cycle.nodes.begin(), cycle.nodes.end());
+  recurrences.reset(&cycle, 3);
+  CHECK(recurrences.getDistance(0) == 1);
+  recurrences.schedule(dfgNodes[1], 0);
+  recurrences.schedule(dfgNodes[3], 2);
+  CHECK(recurrences.getSlack(0) == 0);
+}
@@ -0,0 +1,53 @@
+/*
+ * ======================================================================
+ * SlotBitsetTest.cpp
+ * ======================================================================
+ * The windows of the slot bitset wrap around II.
+ */
+
+#include "mapperTests.h"
+#include "SlotBitset.h"
+
+void testSlotBitset() {
+  SlotBitset slots;
+  slots.reset(10);
+  CHECK(!slots.any());
+  // The window [8, 12) wraps onto the slots 8, 9, 0 and 1.
+  slots.setRange(8, 4);
+  CHECK(slots.count() == 4);
+  CHECK(slots.test(8) and slots.test(9) and slots.test(0) and slots.test(1));
+  CHECK(!slots.test(2) and !slots.test(7));
+  CHECK(!slots.anyInRange(2, 6));
+  CHECK(slots.anyInRange(2, 7));
+  CHECK(slots.anyInRange(9, 2));
+  CHECK(slots.anyInRange(7, 6));
+  CHECK(!slots.anyInRange(5, 0));
+  // A window of II slots or more covers all of them.
+  CHECK(slots.anyInRange(3, 10));
+  slots.setRange(4, 25);
+  CHECK(slots.count() == 10);
+
+  // Across the words of the bitset.
+  SlotBitset wide;
+  wide.reset(70);
+  wide.setRange(60, 8);
+  CHECK(wide.count() == 8);
+  CHECK(wide.test(63) and wide.test(64) and wide.test(67));
+  CHECK(!wide.test(59) and !wide.test(68));
+  CHECK(!wide.anyInRange(68, 2));
+  wide.setRange(69, 3);
+  CHECK(wide.count() == 11);
+  CHECK(wide.test(69) and wide.test(0) and wide.test(1) and !wide.test(2));
+  CHECK(wide.anyInRange(68, 3));
+  CHECK(!wide.anyInRange(2, 58));
+  CHECK(wide.anyInRange(2, 59));
+
+  SlotBitset other;
+  other.reset(70);
+  other.set(2);
+  CHECK(!wide.intersects(other));
+  other.set(64);
+  CHECK(wide.intersects(other));
+  wide.unite(other);
+  CHECK(wide.count() == 12);
+}
@@ -0,0 +1,45 @@
+/*
+ * ======================================================================
+ * mapperTests.cpp
+ * ======================================================================
+ * Unit tests of the mapper core. The tests are run from this directory,
+ * the data files they read are next to them.
+ */
+
+#include <string.h>
+#include "mapperTests.h"
+
+int failedChecks = 0;
+
+struct UnitTest {
+  const char* name;
+  void (*run)();
+};
+
+static UnitTest unitTests[] = {
+  {"SlotBitset", testSlotBitset},
+  {"MappingTrail", testMappingTrail},
+  {"RecMII", testRecMII},
+  {"RecurrenceTracker", testRecurrenceTracker},
+  {"DFGLevels", testDFGLevels},
+  {"Multicast", testMulticast},
+};
+
+// Runs the test named by the argument, or all of them without one.
+int main(int argc, char** argv) {
+  bool found = false;
+  for (UnitTest& test: unitTests) {
+    if (argc > 1 and strcmp(argv[1], test.name) != 0)
+      continue;
+    found = true;
+    int failed = failedChecks;
+    test.run();
+    std::cout<<"["<<test.name<<"] "
+             <<(failedChecks == failed ? "passed" : "failed")<<"\n";
+  }
+  if (!found) {
+    std::cout<<"Unknown test "<<argv[1]<<"\n";
+    return 1;
+  }
+  return failedChecks == 0 ? 0 : 1;
+}
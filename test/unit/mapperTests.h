@@ -0,0 +1,32 @@
+/*
+ * ======================================================================
+ * mapperTests.h
+ * ======================================================================
+ * Unit tests of the mapper core header file.
+ */
+
+#ifndef mapperTests_H
+#define mapperTests_H
+
+#include <iostream>
+
+// The number of checks that failed so far.
+extern int failedChecks;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::cout<<__FILE__<<":"<<__LINE__<<": CHECK("<<#condition \
+               <<") failed\n"; \
+      ++failedChecks; \
+    } \
+  } while (0)
+
+void testSlotBitset();
+void testMappingTrail();
+void testRecMII();
+void testRecurrenceTracker();
+void testDFGLevels();
+void testMulticast();
+
+#endif